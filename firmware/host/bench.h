@@ -0,0 +1,46 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// Timing loop for the host benchmarks. Each case repeats its body for a
+// fixed wall time and reports items (frames, images...) per second, the
+// time per item and bytes per second. Numbers are host-CPU numbers: compare them against each other and
+// across commits, not against the ESP32.
+namespace bench {
+
+// Seconds per case; --quick, which ctest passes, makes it a smoke run
+inline double g_seconds = 0.5;
+
+inline void parseArgs(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--quick")) g_seconds = 0.01;
+    }
+}
+
+// Keeps a result alive without the optimiser folding the work away
+template <class T>
+inline void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+template <class F>
+void run(const char* name, size_t itemsPerCall, size_t bytesPerCall, F&& body) {
+    using Clock = std::chrono::steady_clock;
+    body();  // Warm up
+    size_t calls = 0;
+    double elapsed = 0;
+    const Clock::time_point start = Clock::now();
+    do {
+        for (int i = 0; i < 16; i++) body();
+        calls += 16;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < g_seconds);
+    const double items = itemsPerCall * calls / elapsed;
+    const double mbytes = bytesPerCall * calls / elapsed / 1e6;
+    printf("%-44s %12.0f /s %10.3f us %10.1f MB/s\n", name, items, 1e6 / items, mbytes);
+}
+
+} // namespace bench
@@ -0,0 +1,158 @@
+// MSG_IMAGE: bytes sent for QOI against raw RGB565 and raw rows under LZ4
+// fragments, and QOI decode speed, for a few kinds of image the bridge
+// sends. Each image goes as bands of rows, each band its own QOI image
+// sized to fit one reassembled message.
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "comms/protocol.h"
+#include "display/image_decoder.h"
+#include "bench.h"
+#include "check.h"
+#include "lz4_compress.h"
+#include "qoi_encode.h"
+
+using qoi::Pixel;
+
+struct Image {
+    const char* name;
+    uint32_t w, h;
+    std::vector<Pixel> px;
+};
+
+// What the host sends: colours already at RGB565 precision
+static Pixel to565(Pixel p) {
+    p.r = (p.r & 0xF8) | p.r >> 5;
+    p.g = (p.g & 0xFC) | p.g >> 6;
+    p.b = (p.b & 0xF8) | p.b >> 5;
+    return p;
+}
+
+static Image icon() {
+    Image m{"64x64 icon", 64, 64, {}};
+    const Pixel bg{0x10, 0x14, 0x1a, 255}, fg{0x20, 0xa0, 0xe0, 255}, white{255, 255, 255, 255};
+    for (int y = 0; y < 64; y++) {
+        for (int x = 0; x < 64; x++) {
+            float d = std::sqrt((x - 31.5f) * (x - 31.5f) + (y - 31.5f) * (y - 31.5f));
+            float c = std::min(1.f, std::max(0.f, 28.f - d));  // Anti-aliased disc
+            bool bar = std::abs(x - 32) < 4 && y > 14 && y < 50;
+            Pixel p = bar && c > 0 ? white
+                : Pixel{(uint8_t)(bg.r + (fg.r - bg.r) * c), (uint8_t)(bg.g + (fg.g - bg.g) * c),
+                        (uint8_t)(bg.b + (fg.b - bg.b) * c), 255};
+            m.px.push_back(to565(p));
+        }
+    }
+    return m;
+}
+
+// Coloured diff lines of 5x7 glyphs with line numbers
+static Image diffThumbnail() {
+    Image m{"400x240 diff", 400, 240, {}};
+    std::mt19937 rng(3);
+    uint8_t glyphs[40][7];
+    for (auto& g : glyphs) for (auto& row : g) row = rng() & 0x1F;
+    const int LINE = 12, CELL = 6;
+    std::vector<int> kind(m.h / LINE);
+    std::vector<std::vector<int>> text(m.h / LINE);
+    for (size_t i = 0; i < kind.size(); i++) {
+        kind[i] = rng() % 5;
+        for (int c = 10 + rng() % 50; c > 0; c--) text[i].push_back(rng() % 6 == 0 ? -1 : (int)(rng() % 40));
+    }
+    for (uint32_t y = 0; y < m.h; y++) {
+        for (uint32_t x = 0; x < m.w; x++) {
+            int line = y / LINE, k = kind[line], gy = y % LINE - 3;
+            Pixel bg = k == 0 ? Pixel{0x2a, 0x10, 0x12, 255} : k == 1 ? Pixel{0x10, 0x2a, 0x14, 255} : Pixel{0x16, 0x1a, 0x20, 255};
+            Pixel fg = k == 0 ? Pixel{0xff, 0x80, 0x80, 255} : k == 1 ? Pixel{0x80, 0xff, 0x90, 255} : Pixel{0xc0, 0xc8, 0xd0, 255};
+            bool ink = false;
+            int cx = ((int)x - 36) / CELL, gx = ((int)x - 36) % CELL;
+            if (x >= 36 && cx < (int)text[line].size() && gy >= 0 && gy < 7 && gx < 5) {
+                int g = text[line][cx];
+                ink = g >= 0 && (glyphs[g][gy] >> gx & 1);
+            }
+            if (x < 24 && gy >= 0 && gy < 7) {
+                int g = (line * 7 + x / CELL) % 10;
+                gx = x % CELL;
+                if (gx < 5 && (glyphs[g][gy] >> gx & 1)) {
+                    ink = true;
+                    fg = Pixel{0x60, 0x68, 0x70, 255};
+                }
+            }
+            m.px.push_back(to565(ink ? fg : bg));
+        }
+    }
+    return m;
+}
+
+// Smooth shading with sensor-like noise: QOI's worst case here
+static Image photo() {
+    Image m{"240x160 photo", 240, 160, {}};
+    std::mt19937 rng(5);
+    for (uint32_t y = 0; y < m.h; y++) {
+        for (uint32_t x = 0; x < m.w; x++) {
+            float v = 0.5f + 0.25f * std::sin(x * 0.05f) * std::cos(y * 0.07f);
+            int noise = (int)(rng() % 3) - 1;
+            auto c = [&](float k) { return (uint8_t)std::min(255, std::max(0, (int)(255 * v * k) + noise)); };
+            m.px.push_back(to565(Pixel{c(1.0f), c(0.8f), c(0.6f), 255}));
+        }
+    }
+    return m;
+}
+
+int main(int argc, char** argv) {
+    bench::parseArgs(argc, argv);
+    const uint32_t MESSAGE_LIMIT = MAX_REASSEMBLED_LEN - protocol::IMAGE_HEADER_LEN;
+
+    printf("%-16s %9s %16s %16s\n", "image", "raw", "qoi", "raw+lz4");
+    std::vector<Image> images = {icon(), diffThumbnail(), photo()};
+    for (const Image& m : images) {
+        std::vector<uint16_t> raw(m.w * m.h), out(m.w * m.h);
+        for (size_t i = 0; i < raw.size(); i++) raw[i] = image::rgb565(m.px[i].r, m.px[i].g, m.px[i].b);
+
+        // QOI bands, each as many rows as fit one message
+        std::vector<std::pair<uint32_t, std::vector<uint8_t>>> bands;
+        size_t qoiBytes = 0;
+        for (uint32_t y = 0; y < m.h;) {
+            uint32_t rows = m.h - y;
+            std::vector<uint8_t> q;
+            for (;;) {
+                std::vector<Pixel> band(m.px.begin() + y * m.w, m.px.begin() + (y + rows) * m.w);
+                q = qoi::encode(band, m.w, rows, 3);
+                if (q.size() <= MESSAGE_LIMIT) break;
+                rows = std::max<uint32_t>(1, rows * MESSAGE_LIMIT / q.size());
+            }
+            qoiBytes += q.size() + protocol::IMAGE_HEADER_LEN;
+            bands.push_back({y, q});
+            y += rows;
+        }
+
+        // Raw rows instead, each message's worth LZ4-compressed on its own
+        size_t lz4Bytes = 0;
+        uint32_t bandRows = MESSAGE_LIMIT / (m.w * 2);
+        for (uint32_t y = 0; y < m.h; y += bandRows) {
+            uint32_t rows = std::min(bandRows, m.h - y);
+            lz4Bytes += protocol::IMAGE_HEADER_LEN +
+                        lz4::compress((const uint8_t*)(raw.data() + y * m.w), rows * m.w * 2).size();
+        }
+
+        for (auto& [y, q] : bands) {
+            CHECK(image::decodeQoi(q.data(), q.size(), out.data() + y * m.w, m.w, m.h - y) > 0);
+        }
+        CHECK(out == raw);
+
+        char qoiCol[32], lz4Col[32];
+        snprintf(qoiCol, sizeof(qoiCol), "%zu (%4.1f%%)", qoiBytes, 100.0 * qoiBytes / (raw.size() * 2));
+        snprintf(lz4Col, sizeof(lz4Col), "%zu (%4.1f%%)", lz4Bytes, 100.0 * lz4Bytes / (raw.size() * 2));
+        printf("%-16s %9zu %16s %16s\n", m.name, raw.size() * 2, qoiCol, lz4Col);
+
+        char name[64];
+        snprintf(name, sizeof(name), "decode qoi %s (px)", m.name);
+        bench::run(name, m.w * m.h, raw.size() * 2, [&] {
+            for (auto& [y, q] : bands) image::decodeQoi(q.data(), q.size(), out.data() + y * m.w, m.w, m.h - y);
+            bench::keep(out);
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// LZ4 for long notifications: compression ratio and bytes on the wire
+// against sending the text raw in fragments, and decode speed with the
+// input fed one fragment at a time as the device receives it.
+#include <random>
+#include <string>
+#include <vector>
+#include "comms/fragment_assembler.h"
+#include "comms/protocol.h"
+#include "bench.h"
+#include "check.h"
+#include "lz4_compress.h"
+
+static std::mt19937 s_rng(3);
+
+static std::string pick(const std::vector<std::string>& v) { return v[s_rng() % v.size()]; }
+
+static std::string buildLog(size_t len) {
+    static const std::vector<std::string> kDirs = {"src/comms/", "src/display/", "src/util/", "test/", "lib/lvgl/src/draw/"};
+    static const std::vector<std::string> kFiles = {"serial_comms", "display_manager", "text_view", "glyph_cache",
+                                                    "lv_draw_sw_blend", "notification_history", "asset_store"};
+    std::string s;
+    for (int step = 1; s.size() < len; step++) {
+        char line[160];
+        std::string file = pick(kDirs) + pick(kFiles) + (s_rng() % 2 ? ".cpp" : ".c");
+        if (s_rng() % 9 == 0) {
+            snprintf(line, sizeof(line), "%s:%u:%u: warning: unused variable 'tmp%u' [-Wunused-variable]\n",
+                     file.c_str(), (unsigned)(s_rng() % 900), (unsigned)(s_rng() % 80), (unsigned)(s_rng() % 10));
+        } else {
+            snprintf(line, sizeof(line), "[%3d/412] Compiling CXX object CMakeFiles/app.dir/%s.o\n", step, file.c_str());
+        }
+        s += line;
+    }
+    s.resize(len);
+    return s;
+}
+
+static std::string diff(size_t len) {
+    static const std::vector<std::string> kLines = {
+        "    if (!_active) return false;", "    uint16_t len = getBe16(p + 2);", "    return true;",
+        "    for (size_t i = 0; i < n; i++) {", "    }", "    memcpy(_buf + _rawLen, data, dataLen);",
+        "    _stats.rxFrames++;", "    const uint8_t* body = frame + 3;", "",
+    };
+    std::string s;
+    while (s.size() < len) {
+        char hunk[64];
+        snprintf(hunk, sizeof(hunk), "@@ -%u,7 +%u,8 @@\n", (unsigned)(s_rng() % 500), (unsigned)(s_rng() % 500));
+        s += hunk;
+        for (int i = 0; i < 8; i++) {
+            uint32_t r = s_rng() % 6;
+            s += (r == 0 ? "-" : r == 1 ? "+" : " ") + pick(kLines) + "\n";
+        }
+    }
+    s.resize(len);
+    return s;
+}
+
+static std::string prose(size_t len) {
+    static const char* const kWords[] = {
+        "the", "model", "found", "a", "bug", "in", "parser", "when", "frame", "is", "split", "across", "two",
+        "reads", "and", "it", "now", "waits", "for", "rest", "before", "checking", "length", "which", "fixes",
+        "dropped", "notifications", "seen", "on", "device", "after", "reconnect", "so", "I", "also", "added",
+        "test", "covering", "case", "with", "random", "chunk", "sizes", "that", "passes", "locally", "but",
+        "might", "need", "review", "because", "change", "touches", "timeout", "path", "we", "rarely", "exercise"};
+    std::string s;
+    while (s.size() < len) {
+        s += kWords[s_rng() % (sizeof(kWords) / sizeof(kWords[0]))];
+        s += s_rng() % 12 ? " " : ".\n";
+    }
+    s.resize(len);
+    return s;
+}
+
+// Bytes on the wire for a message sent as MSG_FRAGMENTs in v2 frames
+static size_t wireBytes(size_t dataLen) {
+    const size_t PER_FRAGMENT = MAX_MSG_LEN - 1 - FragmentAssembler::HEADER_LEN;
+    size_t fragments = (dataLen + PER_FRAGMENT - 1) / PER_FRAGMENT;
+    return dataLen + fragments * (1 + FragmentAssembler::HEADER_LEN + protocol::FRAME_OVERHEAD_V2);
+}
+
+int main(int argc, char** argv) {
+    bench::parseArgs(argc, argv);
+    struct Corpus { const char* name; std::string (*make)(size_t); };
+    const Corpus corpora[] = {{"build log", buildLog}, {"diff", diff}, {"prose", prose}};
+
+    printf("%-18s %8s %6s %10s %10s\n", "text", "lz4", "ratio", "wire raw", "wire lz4");
+    for (const Corpus& c : corpora) {
+        for (size_t len : {(size_t)2048, (size_t)MAX_REASSEMBLED_LEN}) {
+            std::string text = c.make(len);
+            std::vector<uint8_t> packed = lz4::compress((const uint8_t*)text.data(), len);
+            char name[32];
+            snprintf(name, sizeof(name), "%s %zu B", c.name, len);
+            printf("%-18s %8zu %6.2f %10zu %10zu\n", name, packed.size(), (double)len / packed.size(),
+                   wireBytes(len), wireBytes(packed.size()));
+        }
+    }
+    printf("\n");
+
+    for (const Corpus& c : corpora) {
+        std::string text = c.make(MAX_REASSEMBLED_LEN);
+        std::vector<uint8_t> packed = lz4::compress((const uint8_t*)text.data(), text.size());
+        std::vector<uint8_t> out(text.size());
+        const size_t PER_FRAGMENT = MAX_MSG_LEN - 1 - FragmentAssembler::HEADER_LEN;
+
+        char name[64];
+        snprintf(name, sizeof(name), "decode %s 8 KiB, per fragment", c.name);
+        bench::run(name, 1, text.size(), [&] {
+            Lz4StreamDecoder dec;
+            dec.begin(out.data(), out.size());
+            for (size_t pos = 0; pos < packed.size(); pos += PER_FRAGMENT) {
+                dec.feed(packed.data() + pos, std::min(PER_FRAGMENT, packed.size() - pos));
+            }
+            bench::keep(out);
+        });
+        CHECK(!memcmp(out.data(), text.data(), text.size()));
+        snprintf(name, sizeof(name), "compress %s 8 KiB (bridge side)", c.name);
+        bench::run(name, 1, text.size(), [&] { bench::keep(lz4::compress((const uint8_t*)text.data(), text.size())); });
+    }
+    return 0;
+}
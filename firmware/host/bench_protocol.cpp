@@ -0,0 +1,228 @@
+// Throughput of the receive path (SerialComms::poll() parsing and
+// dispatching frames), of frame building on the send path, and of the two
+// checksums. The v1 receive path is also run through the per-byte parser
+// it replaced, as the baseline for the block-oriented one.
+#include <Arduino.h>
+#include <vector>
+#include "comms/serial_comms.h"
+#include "bench.h"
+#include "check.h"
+
+enum Framing { FRAMING_V1, FRAMING_V2, FRAMING_COBS };
+static const char* const kFramingNames[] = {"v1", "v2", "cobs"};
+
+static size_t s_delivered = 0;
+static void onText(const msg::DisplayText& m) { s_delivered += m.len; }
+
+static std::vector<uint8_t> frame(Framing framing, uint8_t type, const uint8_t* payload, uint16_t len) {
+    std::vector<uint8_t> out(protocol::MAX_FRAME_LEN);
+    out.resize(framing == FRAMING_COBS ? protocol::buildCobsFrame(out.data(), type, payload, len)
+                                       : protocol::buildFrame(out.data(), type, payload, len,
+                                                              framing == FRAMING_V2 ? protocol::VERSION_2
+                                                                                    : protocol::VERSION_1));
+    return out;
+}
+
+// The parser before the block RX path: one Serial.read() and one millis()
+// per byte through a state machine, copying the body aside
+class PerByteParser {
+public:
+    void poll() {
+        if (_state != WAIT_START && (millis() - _lastByteTime) > FRAME_TIMEOUT_MS) _state = WAIT_START;
+        while (Serial.available()) {
+            uint8_t byte = Serial.read();
+            _lastByteTime = millis();
+            switch (_state) {
+            case WAIT_START:
+                if (byte == FRAME_START_BYTE) _state = READ_LEN_HI;
+                break;
+            case READ_LEN_HI:
+                _bodyLen = (uint16_t)byte << 8;
+                _state = READ_LEN_LO;
+                break;
+            case READ_LEN_LO:
+                _bodyLen |= byte;
+                if (_bodyLen == 0 || _bodyLen > MAX_MSG_LEN) {
+                    _state = WAIT_START;
+                } else {
+                    _bodyIdx = 0;
+                    _state = READ_BODY;
+                }
+                break;
+            case READ_BODY:
+                _buffer[_bodyIdx++] = byte;
+                if (_bodyIdx >= _bodyLen) _state = READ_CHECKSUM;
+                break;
+            case READ_CHECKSUM:
+                if (byte == protocol::checksum(_buffer, _bodyLen) && _buffer[0] == MSG_DISPLAY_TEXT) {
+                    onText(msg::DisplayText{{}, (const char*)_buffer + 1, (uint16_t)(_bodyLen - 1)});
+                }
+                _state = WAIT_START;
+                break;
+            }
+        }
+    }
+
+private:
+    enum ParseState { WAIT_START, READ_LEN_HI, READ_LEN_LO, READ_BODY, READ_CHECKSUM };
+    static const unsigned long FRAME_TIMEOUT_MS = 500;
+    ParseState    _state = WAIT_START;
+    uint8_t       _buffer[MAX_MSG_LEN];
+    uint16_t      _bodyLen = 0;
+    uint16_t      _bodyIdx = 0;
+    unsigned long _lastByteTime = 0;
+};
+
+static std::vector<uint8_t> textStream(Framing framing, uint16_t payloadLen, size_t frames) {
+    std::vector<uint8_t> payload(payloadLen);
+    for (size_t i = 0; i < payloadLen; i++) payload[i] = 'a' + i % 26;
+    std::vector<uint8_t> stream;
+    for (size_t i = 0; i < frames; i++) {
+        std::vector<uint8_t> f = frame(framing, MSG_DISPLAY_TEXT, payload.data(), payloadLen);
+        stream.insert(stream.end(), f.begin(), f.end());
+    }
+    return stream;
+}
+
+static void benchPerByteParser(uint16_t payloadLen, size_t rxChunk) {
+    const size_t FRAMES = 256;
+    std::vector<uint8_t> stream = textStream(FRAMING_V1, payloadLen, FRAMES);
+    PerByteParser parser;
+    Serial.reset();
+    Serial.rxChunk = rxChunk;
+    auto body = [&] {
+        Serial.feed(stream);
+        while (Serial.available()) parser.poll();
+    };
+    s_delivered = 0;
+    body();
+    CHECK(s_delivered == FRAMES * payloadLen);
+
+    char name[64];
+    snprintf(name, sizeof(name), "per-byte v1 %u B payload, %s", payloadLen,
+             rxChunk ? "64 B reads" : "one read");
+    bench::run(name, FRAMES, stream.size(), body);
+    Serial.rxChunk = 0;
+    Serial.reset();
+}
+
+static void benchParser(Framing framing, uint16_t payloadLen, size_t rxChunk) {
+    SerialComms* comms = new SerialComms();
+    comms->begin();
+    comms->on(onText);
+    Serial.reset();
+    if (framing != FRAMING_V1) {
+        uint8_t hello[2] = {protocol::VERSION_2, framing == FRAMING_COBS ? protocol::FEATURE_COBS : (uint8_t)0};
+        Serial.feed(frame(FRAMING_V1, MSG_HELLO, hello, sizeof(hello)));
+        comms->poll();
+        host::runTasks();
+        CHECK(comms->cobsFraming() == (framing == FRAMING_COBS));
+    }
+
+    const size_t FRAMES = 256;
+    std::vector<uint8_t> stream = textStream(framing, payloadLen, FRAMES);
+
+    Serial.rxChunk = rxChunk;
+    auto body = [&] {
+        Serial.feed(stream);
+        while (Serial.available()) comms->poll();
+    };
+    s_delivered = 0;
+    body();
+    CHECK(s_delivered == FRAMES * payloadLen);
+
+    char name[64];
+    snprintf(name, sizeof(name), "poll %s %u B payload, %s", kFramingNames[framing], payloadLen,
+             rxChunk ? "64 B reads" : "one read");
+    bench::run(name, FRAMES, stream.size(), body);
+    Serial.rxChunk = 0;
+    Serial.reset();
+    delete comms;
+}
+
+static void benchBuild(Framing framing, uint16_t payloadLen) {
+    std::vector<uint8_t> payload(payloadLen, 'x');
+    uint8_t buf[protocol::MAX_FRAME_LEN];
+    uint16_t frameLen = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "build %s %u B payload", kFramingNames[framing], payloadLen);
+    auto body = [&] {
+        frameLen = framing == FRAMING_COBS
+            ? protocol::buildCobsFrame(buf, MSG_DISPLAY_TEXT, payload.data(), payloadLen)
+            : protocol::buildFrame(buf, MSG_DISPLAY_TEXT, payload.data(), payloadLen,
+                                   framing == FRAMING_V2 ? protocol::VERSION_2 : protocol::VERSION_1);
+        bench::keep(buf);
+    };
+    body();
+    bench::run(name, 1, frameLen, body);
+}
+
+// The codec on its own, without the CRC and framing around it
+static void benchCobs() {
+    for (uint16_t len : {(uint16_t)16, (uint16_t)400}) {
+        std::vector<uint8_t> data(len);
+        for (size_t i = 0; i < len; i++) data[i] = i % 23 ? 'a' + i % 26 : 0;  // Text with some zeros
+        std::vector<uint8_t> enc(cobs::maxEncodedLen(len));
+        std::vector<uint8_t> out(len);
+        size_t encLen = 0;
+        char name[64];
+        snprintf(name, sizeof(name), "cobs encode %u B", len);
+        bench::run(name, 1, len, [&] {
+            cobs::Encoder encoder(enc.data());
+            encoder.put(data.data(), len);
+            encLen = encoder.finish();
+            bench::keep(enc);
+        });
+        snprintf(name, sizeof(name), "cobs decode %u B", len);
+        bench::run(name, 1, len, [&] {
+            size_t outLen;
+            CHECK(cobs::decode(enc.data(), encLen, out.data(), &outLen));
+            bench::keep(out);
+        });
+    }
+}
+
+// What the slicing tables buy over the textbook loop
+static uint32_t crc32Bitwise(const uint8_t* p, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void benchChecksums() {
+    std::vector<uint8_t> data(64 * 1024);
+    for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(i * 131 + 7);
+    for (uint16_t len : {(uint16_t)MAX_MSG_LEN, (uint16_t)16}) {
+        char name[64];
+        snprintf(name, sizeof(name), "xor checksum %u B", len);
+        bench::run(name, 1, len, [&] { bench::keep(protocol::checksum(data.data(), len)); });
+        snprintf(name, sizeof(name), "crc32 %u B", len);
+        bench::run(name, 1, len, [&] { bench::keep(protocol::crc32(data.data(), len)); });
+    }
+    bench::run("crc32 64 KiB", 1, data.size(), [&] { bench::keep(protocol::crc32(data.data(), data.size())); });
+    bench::run("crc32 bitwise 512 B", 1, MAX_MSG_LEN, [&] { bench::keep(crc32Bitwise(data.data(), MAX_MSG_LEN)); });
+}
+
+int main(int argc, char** argv) {
+    bench::parseArgs(argc, argv);
+    for (uint16_t len : {(uint16_t)16, (uint16_t)400}) {
+        benchPerByteParser(len, 64);
+        benchPerByteParser(len, 0);
+    }
+    for (Framing framing : {FRAMING_V1, FRAMING_V2, FRAMING_COBS}) {
+        for (uint16_t len : {(uint16_t)16, (uint16_t)400}) {
+            benchParser(framing, len, 64);
+            benchParser(framing, len, 0);
+        }
+    }
+    for (Framing framing : {FRAMING_V1, FRAMING_V2, FRAMING_COBS}) {
+        benchBuild(framing, 16);
+        benchBuild(framing, 400);
+    }
+    benchCobs();
+    benchChecksums();
+    return 0;
+}
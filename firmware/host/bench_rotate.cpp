@@ -0,0 +1,40 @@
+// Time per rotate for the kernels in rotate.h and the naive transpose
+// they replaced: a full landscape screen, as partial/direct mode rotate
+// it, and one strip as the strip renderer does.
+#include <random>
+#include <vector>
+#include "config.h"
+#include "display/rotate.h"
+#include "bench.h"
+
+static void rotateNaive(const uint16_t* src, uint16_t* dst, int32_t w, int32_t h,
+                        int32_t srcStride, int32_t dstStride) {
+    for (int32_t y = 0; y < h; y++) {
+        for (int32_t x = 0; x < w; x++) dst[(w - 1 - x) * dstStride + y] = src[y * srcStride + x];
+    }
+}
+
+using Kernel = void (*)(const uint16_t*, uint16_t*, int32_t, int32_t, int32_t, int32_t);
+
+int main(int argc, char** argv) {
+    bench::parseArgs(argc, argv);
+    const int32_t W = SCREEN_WIDTH, H = SCREEN_HEIGHT;
+    const int32_t STRIP = (SCREEN_HEIGHT / 10) & ~1;  // DISPLAY_STRIP_DIVISOR 10
+    std::vector<uint16_t> src(W * H), dst(W * H);
+    std::mt19937 rng(1);
+    for (uint16_t& p : src) p = rng();
+
+    struct Case { const char* name; Kernel k; };
+    const Case kernels[] = {{"naive", rotateNaive}, {"scalar", rotate90Rgb565Scalar}, {"pairs", rotate90Rgb565Pairs}};
+    for (int32_t lines : {H, STRIP}) {
+        for (const Case& c : kernels) {
+            char name[64];
+            snprintf(name, sizeof(name), "%s %dx%d", c.name, W, lines);
+            bench::run(name, 1, W * lines * 2, [&] {
+                c.k(src.data(), dst.data(), W, lines, W, lines);
+                bench::keep(dst);
+            });
+        }
+    }
+    return 0;
+}
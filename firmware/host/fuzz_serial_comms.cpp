@@ -0,0 +1,385 @@
+// Fuzz target for the receive path: SerialComms::poll() and, through it,
+// processMessage(), the dispatch table and every message parser, the
+// batch and fragment handlers, HELLO renegotiation and reliable mode.
+//
+// The input is a script rather than raw wire bytes, so that mutations land
+// on frames that pass their checksum and reach the parsers:
+//
+//   [rx chunking] then records of [op] [args...]
+//     OP_MESSAGE    [type] [len(2)] [payload...]   framed the way the device
+//                                                   currently expects
+//     OP_CORRUPT    [bit] [type] [len(2)] [payload...]  same, one bit flipped
+//     OP_GARBAGE    [len] [bytes...]               raw, unframed
+//     OP_HELLO      [max_version] [features]
+//     OP_POLL       [10 ms ticks]                  poll, run the TX task
+//     OP_REPLAY                                    resend the last frame
+//
+// The handlers check what the views promise. Built with clang and
+// -DHOST_LIBFUZZER=ON this is a libFuzzer target; otherwise main() below
+// runs scripts given as files, or random ones.
+#include <Arduino.h>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+#include "comms/serial_comms.h"
+#include "check.h"
+
+enum Op : uint8_t { OP_MESSAGE, OP_CORRUPT, OP_GARBAGE, OP_HELLO, OP_POLL, OP_REPLAY, OP_COUNT };
+
+static volatile uint8_t s_sink;
+
+static void touch(const void* p, size_t len) {
+    uint8_t x = 0;
+    for (size_t i = 0; i < len; i++) x ^= ((const uint8_t*)p)[i];
+    s_sink = x;
+}
+
+static void onText(const msg::DisplayText& m) {
+    CHECK(m.len >= 1 && m.len <= MAX_REASSEMBLED_LEN);
+    touch(m.text, m.len);
+}
+
+static void onStatus(const msg::StatusText& m) {
+    CHECK(m.len >= 1 && m.len <= MAX_REASSEMBLED_LEN);
+    touch(m.text, m.len);
+}
+
+static void onLeds(const msg::SetLeds& m) {
+    for (uint16_t i = 0; i < m.count; i++) s_sink = m.pixel(i) ^ (uint8_t)m.color(i);
+}
+
+// The truncated label must still be valid UTF-8 for LVGL: the cut can't
+// land on a continuation byte. This is what caught labels being cut
+// mid-sequence before Label::copyTo().
+static void onLabels(const msg::SetLabels& m) {
+    for (const auto& label : m.labels) {
+        char buf[BUTTON_LABEL_MAX + 1];
+        uint8_t n = label.copyTo(buf, sizeof(buf));
+        CHECK(n <= BUTTON_LABEL_MAX && n <= label.len && buf[n] == '\0');
+        CHECK(memcmp(buf, label.text, n) == 0);
+        CHECK(n == label.len || n == 0 || ((uint8_t)label.text[n] & 0xC0) != 0x80);
+    }
+}
+
+static void onPatch(const msg::TextPatch& m) {
+    CHECK(m.op <= protocol::TEXT_OP_TRUNCATE);
+    CHECK(m.op != protocol::TEXT_OP_TRUNCATE || m.len == 0);
+    touch(m.data, m.len);
+}
+
+static void onImage(const msg::Image& m) {
+    if (m.w) {
+        CHECK(m.x + m.w <= SCREEN_WIDTH && m.y + m.h <= SCREEN_HEIGHT && m.row < m.h);
+        CHECK(m.encoding <= protocol::IMAGE_QOI);
+    }
+    touch(m.data, m.len);
+}
+
+static void onAssetShow(const msg::AssetShow& m) {
+    touch(m.hash, protocol::ASSET_HASH_LEN);
+}
+
+static void onAssetPut(const msg::AssetPut& m) {
+    CHECK(m.bodyLen == m.len + (protocol::ASSET_HEADER_LEN - protocol::ASSET_HASH_LEN));
+    CHECK(m.w > 0 && m.w <= SCREEN_WIDTH && m.h > 0 && m.h <= SCREEN_HEIGHT);
+    touch(m.hash, protocol::ASSET_HASH_LEN);
+    touch(m.body, m.bodyLen);
+}
+
+static bool s_inBatch = false;
+static void onBatchBegin() { CHECK(!s_inBatch); s_inBatch = true; }
+static void onBatchEnd()   { CHECK(s_inBatch); s_inBatch = false; }
+
+static uint16_t onGetStats(uint8_t, const uint8_t* args, uint16_t argsLen, uint8_t* out, uint16_t cap) {
+    CHECK(cap <= protocol::MAX_STATS_LEN);
+    touch(args, argsLen);
+    memset(out, 0xA5, cap);
+    return cap;
+}
+
+static SerialComms& comms() {
+    static SerialComms* c = [] {
+        SerialComms* c = new SerialComms();
+        c->begin();
+        c->on(onText);
+        c->on(onStatus);
+        c->on(onLeds);
+        c->on(onLabels);
+        c->on(onPatch);
+        c->on(onImage);
+        c->on(onAssetShow);
+        c->on(onAssetPut);
+        c->onBatchBegin(onBatchBegin);
+        c->onBatchEnd(onBatchEnd);
+        c->onGetStats(onGetStats);
+        return c;
+    }();
+    return *c;
+}
+
+// What the host side of the link has negotiated
+struct HostLink {
+    bool    reliable = false;
+    uint8_t seq = 0;
+    std::vector<uint8_t> last;
+};
+
+// The device's reply to the last MSG_HELLO it answered, if any: [versions,
+// selected, features] in a v1 frame
+static bool findHelloReply(const std::vector<uint8_t>& tx, uint8_t* features) {
+    bool found = false;
+    for (size_t i = 0; i + 8 <= tx.size(); i++) {
+        const uint8_t* f = tx.data() + i;
+        if (f[0] == FRAME_START_BYTE && f[1] == 0 && f[2] == 4 && f[3] == MSG_HELLO &&
+            protocol::verifyFrame(f, 4)) {
+            *features = f[6];
+            found = true;
+        }
+    }
+    return found;
+}
+
+static void pollDevice(HostLink& link) {
+    SerialComms& c = comms();
+    while (Serial.available()) c.poll();
+    c.poll();
+    host::runTasks();
+    uint8_t features;
+    if (findHelloReply(Serial.tx, &features)) {
+        link.reliable = (features & protocol::FEATURE_RELIABLE) != 0;
+        link.seq = 0;
+    }
+    if (!c.bridgeConnected()) link.reliable = false;
+    Serial.tx.clear();
+}
+
+static std::vector<uint8_t> frame(HostLink& link, uint8_t type, const uint8_t* payload, uint16_t len) {
+    std::vector<uint8_t> body;
+    if (link.reliable) body.push_back(link.seq++);
+    body.push_back(type);
+    body.insert(body.end(), payload, payload + len);
+
+    SerialComms& c = comms();
+    std::vector<uint8_t> out(protocol::MAX_FRAME_LEN);
+    uint16_t n = c.cobsFraming()
+        ? protocol::buildCobsFrame(out.data(), body[0], body.data() + 1, body.size() - 1)
+        : protocol::buildFrame(out.data(), body[0], body.data() + 1, body.size() - 1, c.protocolVersion());
+    out.resize(n);
+    return out;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    // Back to a fresh link: silence past the bridge timeout resets framing
+    Serial.reset();
+    Serial.rxChunk = 0;
+    host::advanceUs(60 * 1000 * 1000);
+    HostLink link;
+    pollDevice(link);
+    s_inBatch = false;
+    if (size == 0) return 0;
+
+    static const size_t kChunks[] = {0, 1, 7, 64};
+    Serial.rxChunk = kChunks[data[0] % 4];
+    size_t pos = 1;
+    auto take = [&](size_t n) {
+        const uint8_t* p = data + pos;
+        pos += n < size - pos ? n : size - pos;
+        return p;
+    };
+    auto byte = [&]() -> uint8_t { return pos < size ? data[pos++] : 0; };
+
+    while (pos < size) {
+        uint8_t op = byte() % OP_COUNT;
+        switch (op) {
+        case OP_MESSAGE:
+        case OP_CORRUPT: {
+            uint8_t bit = op == OP_CORRUPT ? byte() : 0;
+            uint8_t type = byte();
+            uint16_t len = byte() << 8;
+            len = (len | byte()) % (MAX_MSG_LEN - 1);
+            size_t before = pos;
+            const uint8_t* payload = take(len);
+            link.last = frame(link, type, payload, pos - before);
+            if (op == OP_CORRUPT) link.last[bit % link.last.size()] ^= 1 << (bit % 8);
+            Serial.feed(link.last);
+            break;
+        }
+        case OP_GARBAGE: {
+            uint8_t len = byte();
+            size_t before = pos;
+            const uint8_t* bytes = take(len);
+            Serial.feed(bytes, pos - before);
+            break;
+        }
+        case OP_HELLO: {
+            uint8_t hello[2] = {byte(), byte()};
+            Serial.feed(frame(link, MSG_HELLO, hello, sizeof(hello)));
+            pollDevice(link);
+            break;
+        }
+        case OP_POLL:
+            host::advanceUs(byte() * 10000);
+            pollDevice(link);
+            break;
+        case OP_REPLAY:
+            Serial.feed(link.last);
+            break;
+        }
+    }
+    pollDevice(link);
+    CHECK(!s_inBatch);
+    return 0;
+}
+
+#ifndef HOST_LIBFUZZER
+
+// --- Standalone driver: random scripts shaped like real traffic ---
+
+static std::mt19937 s_rng;
+
+static uint8_t rnd(uint32_t n) { return (uint8_t)(s_rng() % n); }
+
+static void put16(std::vector<uint8_t>& s, uint16_t v) {
+    s.push_back(v >> 8);
+    s.push_back(v & 0xFF);
+}
+
+// A label that often runs past BUTTON_LABEL_MAX in multi-byte characters
+static void appendLabel(std::vector<uint8_t>& p) {
+    static const char* const kPieces[] = {"a", "Ok ", "é", "→", "✓ ", "日本", "🙂"};
+    std::string label;
+    size_t target = rnd(48);
+    while (label.size() < target) label += kPieces[rnd(7)];
+    p.push_back((uint8_t)label.size());
+    p.insert(p.end(), label.begin(), label.end());
+}
+
+static std::vector<uint8_t> randomPayload(uint8_t type) {
+    std::vector<uint8_t> p;
+    switch (type) {
+    case MSG_SET_LABELS:
+        for (int i = rnd(5); i > 0; i--) appendLabel(p);
+        break;
+    case MSG_BATCH:
+        for (int i = rnd(5); i > 0; i--) {
+            uint8_t sub = rnd(4) ? (uint8_t)(1 + rnd(MSG_ASSET_PUT)) : MSG_BATCH;
+            std::vector<uint8_t> inner = randomPayload(sub == MSG_BATCH ? MSG_STATUS : sub);
+            if (inner.size() > 100) inner.resize(100);
+            p.push_back(sub);
+            put16(p, rnd(8) ? inner.size() : inner.size() + rnd(4));
+            p.insert(p.end(), inner.begin(), inner.end());
+        }
+        break;
+    case MSG_FRAGMENT: {
+        static uint8_t msgId = 0, index = 0;
+        if (rnd(4) == 0) { msgId++; index = 0; }
+        uint16_t total = rnd(4) ? 600 + rnd(200) : s_rng() % (MAX_REASSEMBLED_LEN + 16);
+        p = {msgId, index++, rnd(2) ? (uint8_t)MSG_DISPLAY_TEXT : (uint8_t)MSG_SET_LABELS,
+             (uint8_t)(rnd(4) == 0 ? protocol::CODEC_LZ4 : protocol::CODEC_RAW)};
+        put16(p, total);
+        for (int i = rnd(300); i > 0; i--) p.push_back(rnd(8) ? 'a' + rnd(26) : (uint8_t)s_rng());
+        break;
+    }
+    case MSG_TEXT_PATCH:
+        p = {rnd(4), (uint8_t)s_rng(), (uint8_t)s_rng()};
+        for (int i = rnd(40); i > 0; i--) p.push_back((uint8_t)s_rng());
+        break;
+    case MSG_IMAGE:
+        put16(p, rnd(2) ? rnd(200) : (uint16_t)s_rng());
+        put16(p, rnd(200));
+        put16(p, rnd(120));
+        put16(p, 1 + rnd(120));
+        put16(p, rnd(120));
+        p.push_back(rnd(3));
+        for (int i = rnd(400); i > 0; i--) p.push_back((uint8_t)s_rng());
+        break;
+    case MSG_GET_STATS:
+        p = {rnd(10)};
+        for (int i = rnd(6); i > 0; i--) p.push_back((uint8_t)s_rng());
+        break;
+    default:
+        for (int i = rnd(4) ? rnd(64) : (int)(s_rng() % 600); i > 0; i--) p.push_back((uint8_t)s_rng());
+        break;
+    }
+    return p;
+}
+
+static std::vector<uint8_t> randomScript() {
+    std::vector<uint8_t> s = {rnd(4)};
+    for (int records = 1 + rnd(40); records > 0; records--) {
+        uint8_t r = rnd(100);
+        if (r < 70) {
+            uint8_t type = rnd(10) ? (uint8_t)(1 + rnd(MSG_ASSET_PUT)) : (uint8_t)s_rng();
+            if (rnd(4) == 0) type = MSG_SET_LABELS;
+            std::vector<uint8_t> payload = randomPayload(type);
+            if (payload.size() > MAX_MSG_LEN - 2) payload.resize(MAX_MSG_LEN - 2);
+            bool corrupt = rnd(10) == 0;
+            s.push_back(corrupt ? OP_CORRUPT : OP_MESSAGE);
+            if (corrupt) s.push_back((uint8_t)s_rng());
+            s.push_back(type);
+            put16(s, payload.size());
+            s.insert(s.end(), payload.begin(), payload.end());
+        } else if (r < 76) {
+            s.push_back(OP_GARBAGE);
+            uint8_t len = rnd(64);
+            s.push_back(len);
+            for (int i = 0; i < len; i++) s.push_back(rnd(3) ? (uint8_t)s_rng() : FRAME_START_BYTE);
+        } else if (r < 82) {
+            s.push_back(OP_HELLO);
+            s.push_back(rnd(4));
+            s.push_back(rnd(8));
+        } else if (r < 95) {
+            s.push_back(OP_POLL);
+            s.push_back(rnd(10) ? rnd(5) : (uint8_t)s_rng());
+        } else {
+            s.push_back(OP_REPLAY);
+        }
+    }
+    return s;
+}
+
+static bool runFile(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) data.insert(data.end(), buf, buf + n);
+    fclose(f);
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    return true;
+}
+
+// fuzz_serial_comms [--runs N] [--seed S] [files...]
+int main(int argc, char** argv) {
+    long runs = 20000;
+    unsigned seed = 1;
+    int files = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = atol(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = (unsigned)atol(argv[++i]);
+        } else if (runFile(argv[i])) {
+            files++;
+        } else {
+            fprintf(stderr, "can't read %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (files) {
+        printf("%d inputs ok\n", files);
+        return 0;
+    }
+    s_rng.seed(seed);
+    for (long i = 0; i < runs; i++) {
+        std::vector<uint8_t> script = randomScript();
+        LLVMFuzzerTestOneInput(script.data(), script.size());
+    }
+    const SerialComms::LinkStats& st = comms().linkStats();
+    printf("%ld scripts ok: %u frames, %u bad, %u gaps\n", runs, st.rxFrames, st.rxBadFrames, st.rxGaps);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Greedy LZ4 block compressor for the host tests and benchmarks: the
+// output is valid LZ4 block format, as lz4.block.compress(store_size=False)
+// on the bridge side produces, without needing liblz4. Ratios come out a
+// little worse than LZ4_compress_default's, so they are a lower bound.
+namespace lz4 {
+
+inline void putLength(std::vector<uint8_t>& out, size_t len) {
+    for (; len >= 255; len -= 255) out.push_back(255);
+    out.push_back((uint8_t)len);
+}
+
+inline void putSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t litLen,
+                        size_t offset, size_t matchLen) {
+    uint8_t token = (uint8_t)((litLen < 15 ? litLen : 15) << 4);
+    if (matchLen) token |= matchLen - 4 < 15 ? matchLen - 4 : 15;
+    out.push_back(token);
+    if (litLen >= 15) putLength(out, litLen - 15);
+    out.insert(out.end(), literals, literals + litLen);
+    if (!matchLen) return;
+    out.push_back(offset & 0xFF);
+    out.push_back(offset >> 8);
+    if (matchLen - 4 >= 15) putLength(out, matchLen - 4 - 15);
+}
+
+inline std::vector<uint8_t> compress(const uint8_t* in, size_t len) {
+    static const size_t MIN_MATCH = 4;
+    static const size_t LAST_LITERALS = 5;    // The block ends in at least 5 literals
+    static const size_t MATCH_LIMIT = 12;     // No match starts in the last 12 bytes
+    static const size_t MAX_OFFSET = 65535;
+    static const int    HASH_BITS = 12;
+
+    std::vector<uint8_t> out;
+    std::vector<int32_t> table(1 << HASH_BITS, -1);
+    auto hash = [&](size_t i) {
+        uint32_t v;
+        memcpy(&v, in + i, 4);
+        return (v * 2654435761u) >> (32 - HASH_BITS);
+    };
+
+    size_t anchor = 0;
+    size_t i = 0;
+    while (len >= MATCH_LIMIT && i + MATCH_LIMIT <= len) {
+        uint32_t h = hash(i);
+        int32_t candidate = table[h];
+        table[h] = (int32_t)i;
+        if (candidate < 0 || i - candidate > MAX_OFFSET || memcmp(in + candidate, in + i, MIN_MATCH)) {
+            i++;
+            continue;
+        }
+        size_t matchLen = MIN_MATCH;
+        while (i + matchLen < len - LAST_LITERALS && in[candidate + matchLen] == in[i + matchLen]) matchLen++;
+        putSequence(out, in + anchor, i - anchor, i - candidate, matchLen);
+        i += matchLen;
+        anchor = i;
+    }
+    putSequence(out, in + anchor, len - anchor, 0, 0);
+    return out;
+}
+
+} // namespace lz4
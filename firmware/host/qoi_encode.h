@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Reference QOI encoder (qoiformat.org spec), standing in for the bridge
+// in the host tests and benchmarks.
+namespace qoi {
+
+struct Pixel {
+    uint8_t r, g, b, a;
+};
+
+inline std::vector<uint8_t> encode(const std::vector<Pixel>& px, uint32_t w, uint32_t h, uint8_t channels) {
+    std::vector<uint8_t> out = {'q', 'o', 'i', 'f'};
+    auto be32 = [&](uint32_t v) {
+        for (int s = 24; s >= 0; s -= 8) out.push_back(v >> s);
+    };
+    be32(w);
+    be32(h);
+    out.push_back(channels);
+    out.push_back(0);
+
+    Pixel index[64] = {};
+    Pixel prev = {0, 0, 0, 255};
+    int run = 0;
+    for (size_t i = 0; i < (size_t)w * h; i++) {
+        Pixel p = px[i];
+        if (channels == 3) p.a = prev.a;
+        if (!memcmp(&p, &prev, 4)) {
+            if (++run == 62 || i == (size_t)w * h - 1) {
+                out.push_back(0xC0 | (run - 1));
+                run = 0;
+            }
+            continue;
+        }
+        if (run) {
+            out.push_back(0xC0 | (run - 1));
+            run = 0;
+        }
+        int slot = (p.r * 3 + p.g * 5 + p.b * 7 + p.a * 11) % 64;
+        if (!memcmp(&index[slot], &p, 4)) {
+            out.push_back(slot);
+        } else {
+            index[slot] = p;
+            if (p.a == prev.a) {
+                int8_t dr = p.r - prev.r, dg = p.g - prev.g, db = p.b - prev.b;
+                int8_t dgr = dr - dg, dgb = db - dg;
+                if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+                    out.push_back(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                } else if (dgr > -9 && dgr < 8 && dg > -33 && dg < 32 && dgb > -9 && dgb < 8) {
+                    out.push_back(0x80 | (dg + 32));
+                    out.push_back((dgr + 8) << 4 | (dgb + 8));
+                } else {
+                    out.insert(out.end(), {0xFE, p.r, p.g, p.b});
+                }
+            } else {
+                out.insert(out.end(), {0xFF, p.r, p.g, p.b, p.a});
+            }
+        }
+        prev = p;
+    }
+    out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+    return out;
+}
+
+} // namespace qoi
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <vector>
+#include "comms/protocol.h"
+
+// Reference sender for FEATURE_RELIABLE (see protocol.h), standing in for
+// the bridge in the host tests: go-back-N over v2 frames. Messages are
+// numbered and kept until acknowledged. A duplicate ACK means the device
+// dropped frames after a gap, so everything from the oldest unacked frame
+// is sent again; so it is when no ACK has made progress for rtoUs, which
+// covers a lost ACK or a loss at the tail of a burst. Bytes in flight are
+// held to the credit of the last ACK.
+//
+// The caller negotiates FEATURE_RELIABLE with MSG_HELLO first; the first
+// frame sent here is SEQ 0.
+class ReliableHost {
+public:
+    struct Stats {
+        uint32_t sent;         // Frames written, resends included
+        uint32_t retransmits;  // Frames written again
+        uint32_t goBacks;      // Resends from the oldest unacked frame on a duplicate ACK
+        uint32_t timeouts;     // ... because no ACK made progress for rtoUs
+        uint32_t acks;         // Device MSG_ACKs received
+        uint32_t badFrames;    // Device frames that failed their checksum
+    };
+
+    // credit: what to assume before the first ACK, the device's RX buffer
+    explicit ReliableHost(int64_t rtoUs, uint16_t credit = 2048) : _rtoUs(rtoUs), _credit(credit) {}
+
+    void send(uint8_t type, const uint8_t* payload, uint16_t len) {
+        std::vector<uint8_t> body(2 + len);
+        body[0] = _nextSeq++;
+        body[1] = type;
+        if (len) memcpy(&body[2], payload, len);
+        Pending p;
+        p.frame.resize(protocol::MAX_FRAME_LEN);
+        p.frame.resize(protocol::buildFrame(p.frame.data(), body[0], body.data() + 1, body.size() - 1,
+                                            protocol::VERSION_2));
+        _queue.push_back(p);
+    }
+
+    // Bytes the device wrote; MSG_ACKs are acted on, other frames ignored
+    void receive(const uint8_t* data, size_t len, int64_t nowUs) {
+        _rx.insert(_rx.end(), data, data + len);
+        size_t pos = 0;
+        while (pos < _rx.size()) {
+            uint8_t start = _rx[pos];
+            if (start != FRAME_START_BYTE && start != FRAME_START_BYTE_V2) {
+                pos++;
+                continue;
+            }
+            if (_rx.size() - pos < 3) break;
+            uint16_t bodyLen = _rx[pos + 1] << 8 | _rx[pos + 2];
+            if (bodyLen == 0 || bodyLen > MAX_MSG_LEN) {
+                pos++;
+                continue;
+            }
+            uint8_t version = start == FRAME_START_BYTE_V2 ? protocol::VERSION_2 : protocol::VERSION_1;
+            size_t frameLen = bodyLen + protocol::frameOverhead(version);
+            if (_rx.size() - pos < frameLen) break;
+            if (!protocol::verifyFrame(&_rx[pos], bodyLen)) {
+                _stats.badFrames++;
+                pos++;
+                continue;
+            }
+            const uint8_t* body = &_rx[pos + 3];
+            if (body[0] == MSG_ACK && bodyLen == 4) onAck(body[1], body[2] << 8 | body[3], nowUs);
+            pos += frameLen;
+        }
+        _rx.erase(_rx.begin(), _rx.begin() + pos);
+    }
+
+    // Writes, through write(const uint8_t*, size_t), the frames the window
+    // allows, after going back to the oldest unacked frame if the timer ran out
+    template <class Write>
+    void pump(int64_t nowUs, Write&& write) {
+        if (_inFlight > 0 && nowUs - _progressUs >= _rtoUs) {
+            _stats.timeouts++;
+            goBack();
+        }
+        while (_inFlight < _queue.size() && _inFlight < MAX_IN_FLIGHT) {
+            Pending& p = _queue[_inFlight];
+            // One frame always goes, so a credit of 0 can't stall the link
+            if (_inFlight > 0 && _bytesInFlight + p.frame.size() > _credit) break;
+            if (_inFlight == 0) _progressUs = nowUs;
+            write(p.frame.data(), p.frame.size());
+            _stats.sent++;
+            if (p.sent) _stats.retransmits++;
+            p.sent = true;
+            _bytesInFlight += p.frame.size();
+            _inFlight++;
+        }
+    }
+
+    bool idle() const { return _queue.empty(); }
+    size_t queued() const { return _queue.size(); }
+    const Stats& stats() const { return _stats; }
+
+private:
+    struct Pending {
+        std::vector<uint8_t> frame;
+        bool sent = false;
+    };
+
+    // The device treats a SEQ up to 128 behind the next one as a duplicate
+    static const size_t MAX_IN_FLIGHT = 128;
+
+    void onAck(uint8_t ackSeq, uint16_t credit, int64_t nowUs) {
+        _stats.acks++;
+        _credit = credit;
+        size_t acked = (uint8_t)(ackSeq - _baseSeq + 1);
+        if (acked == 0) {
+            // Frames after a gap were dropped. Once per loss: the frames
+            // already sent behind the gap draw duplicate ACKs of their own.
+            if (_inFlight > 0 && !_recovering) {
+                _stats.goBacks++;
+                goBack();
+            }
+            return;
+        }
+        // Beyond what was ever sent: stale, from before SEQ wrapped
+        if (acked > _queue.size() || !_queue[acked - 1].sent) return;
+        // Frames sent before going back count too, though not in flight now
+        for (size_t i = 0; i < acked; i++) {
+            if (_inFlight > 0) {
+                _bytesInFlight -= _queue.front().frame.size();
+                _inFlight--;
+            }
+            _queue.pop_front();
+        }
+        _baseSeq += acked;
+        _progressUs = nowUs;
+        _recovering = false;
+    }
+
+    void goBack() {
+        _inFlight = 0;
+        _bytesInFlight = 0;
+        _recovering = true;
+    }
+
+    std::deque<Pending> _queue;  // Unacked, oldest first; the first _inFlight are sent
+    std::vector<uint8_t> _rx;
+    int64_t  _rtoUs;
+    int64_t  _progressUs = 0;
+    uint16_t _credit;
+    size_t   _inFlight = 0;
+    size_t   _bytesInFlight = 0;
+    uint8_t  _baseSeq = 0;  // SEQ of _queue.front()
+    uint8_t  _nextSeq = 0;
+    bool     _recovering = false;
+    Stats    _stats = {};
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+// Host stand-in for the parts of the Arduino core the firmware sources use.
+// Serial is a byte pipe: tests feed() the host→device side and read what the
+// device wrote from tx.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "host_clock.h"
+
+inline unsigned long millis() { return (unsigned long)(host::nowUs() / 1000); }
+inline void delay(unsigned long ms) { host::advanceUs((int64_t)ms * 1000); }
+
+class HostSerial {
+public:
+    // Bytes the driver hands out per available()/read() pair, like the
+    // 64-byte packets USB CDC delivers; 0 hands out everything buffered
+    size_t rxChunk = 0;
+    std::vector<uint8_t> tx;
+
+    void feed(const uint8_t* data, size_t len) { _rx.insert(_rx.end(), data, data + len); }
+    void feed(const std::vector<uint8_t>& data) { feed(data.data(), data.size()); }
+    void reset() { _rx.clear(); _rxPos = 0; tx.clear(); }
+
+    int available() {
+        size_t left = _rx.size() - _rxPos;
+        if (left == 0) { _rx.clear(); _rxPos = 0; }
+        return (int)(rxChunk && left > rxChunk ? rxChunk : left);
+    }
+    int read() { return _rxPos < _rx.size() ? _rx[_rxPos++] : -1; }
+    size_t read(uint8_t* buf, size_t len) {
+        size_t n = (size_t)available();
+        if (n > len) n = len;
+        memcpy(buf, _rx.data() + _rxPos, n);
+        _rxPos += n;
+        return n;
+    }
+    size_t write(const uint8_t* buf, size_t len) { tx.insert(tx.end(), buf, buf + len); return len; }
+    size_t write(uint8_t b) { tx.push_back(b); return 1; }
+    template <class... Args>
+    void printf(const char*, Args...) {}
+    void println(const char* = "") {}
+
+private:
+    std::vector<uint8_t> _rx;
+    size_t _rxPos = 0;
+};
+
+extern HostSerial Serial;
@@ -0,0 +1,138 @@
+#pragma once
+
+// Host stand-in for LittleFS: the partition is a flat directory on the host,
+// with littlefs' space accounting (whole blocks per file, two for the
+// superblocks) against a set capacity. Tests point host::flash.dir at a
+// directory of their own before begin(), and can make writes fail part way
+// through to stand in for a reset during one.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace host {
+struct Flash {
+    std::string dir;
+    size_t capacity = 1 << 20;
+    size_t block = 4096;
+    long   failAfter = -1;  // Bytes written before every write comes up short
+};
+extern Flash flash;
+}
+
+// Move-only, where Arduino's File is a shared handle; the firmware never
+// copies one
+class File {
+public:
+    File() = default;
+    File(const std::string& path, bool dir, const char* mode) : _path(path), _dir(dir) {
+        if (dir) _d = opendir(path.c_str());
+        else _f = fopen(path.c_str(), mode[0] == 'w' ? "wb" : "rb");
+    }
+    File(const File&) = delete;
+    File(File&& o) { *this = static_cast<File&&>(o); }
+    File& operator=(File&& o) {
+        close();
+        _path = o._path;
+        _dir = o._dir;
+        _f = o._f;
+        _d = o._d;
+        o._f = nullptr;
+        o._d = nullptr;
+        return *this;
+    }
+    ~File() { close(); }
+
+    explicit operator bool() const { return _f || _d; }
+    bool isDirectory() const { return _dir; }
+    const char* name() const {
+        size_t slash = _path.rfind('/');
+        return _path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+    }
+    size_t size() const {
+        struct stat st;
+        return stat(_path.c_str(), &st) == 0 ? (size_t)st.st_size : 0;
+    }
+
+    size_t write(const uint8_t* buf, size_t len) {
+        if (!_f) return 0;
+        if (host::flash.failAfter >= 0) {
+            if ((size_t)host::flash.failAfter < len) len = host::flash.failAfter;
+            host::flash.failAfter -= len;
+        }
+        len = fwrite(buf, 1, len, _f);
+        fflush(_f);
+        return len;
+    }
+    size_t read(uint8_t* buf, size_t len) { return _f ? fread(buf, 1, len, _f) : 0; }
+
+    File openNextFile() {
+        if (!_d) return File();
+        while (dirent* e = readdir(_d)) {
+            if (!strcmp(e->d_name, ".") || !strcmp(e->d_name, "..")) continue;
+            std::string path = _path + "/" + e->d_name;
+            struct stat st;
+            bool dir = stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+            return File(path, dir, "r");
+        }
+        return File();
+    }
+
+    void close() {
+        if (_f) fclose(_f);
+        if (_d) closedir(_d);
+        _f = nullptr;
+        _d = nullptr;
+    }
+
+private:
+    std::string _path;
+    bool  _dir = false;
+    FILE* _f = nullptr;
+    DIR*  _d = nullptr;
+};
+
+class LittleFSFS {
+public:
+    bool begin(bool, const char*, uint8_t, const char*) {
+        mkdir(host::flash.dir.c_str(), 0755);
+        return true;
+    }
+
+    size_t totalBytes() { return host::flash.capacity; }
+    size_t usedBytes() {
+        size_t used = 2 * host::flash.block;
+        DIR* d = opendir(host::flash.dir.c_str());
+        if (!d) return used;
+        while (dirent* e = readdir(d)) {
+            struct stat st;
+            if (e->d_name[0] == '.' && (!e->d_name[1] || e->d_name[1] == '.')) continue;
+            if (stat((host::flash.dir + "/" + e->d_name).c_str(), &st) != 0) continue;
+            used += (st.st_size + host::flash.block - 1) / host::flash.block * host::flash.block;
+        }
+        closedir(d);
+        return used;
+    }
+
+    // A new file needs a free block
+    File open(const char* path, const char* mode = "r") {
+        std::string full = host::flash.dir + (strcmp(path, "/") ? path : "");
+        struct stat st;
+        bool dir = stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+        if (!dir && mode[0] == 'w' && usedBytes() + host::flash.block > host::flash.capacity) {
+            return File();
+        }
+        return File(full, dir, mode);
+    }
+    bool rename(const char* from, const char* to) {
+        return ::rename((host::flash.dir + from).c_str(), (host::flash.dir + to).c_str()) == 0;
+    }
+    bool remove(const char* path) { return unlink((host::flash.dir + path).c_str()) == 0; }
+};
+
+extern LittleFSFS LittleFS;
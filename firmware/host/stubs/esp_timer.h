@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+#include "host_clock.h"
+
+inline int64_t esp_timer_get_time() { return host::nowUs(); }
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+typedef void*    TaskHandle_t;
+typedef void*    SemaphoreHandle_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define portMAX_DELAY 0xffffffffu
+#define pdMS_TO_TICKS(ms) (ms)
+#define ARDUINO_RUNNING_CORE 1
+#define IRAM_ATTR
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+// Tasks don't run concurrently on the host. xTaskCreatePinnedToCore records
+// the task, and host::runTasks() runs each one that has a notification
+// pending until it blocks again: a ulTaskNotifyTake() with nothing pending
+// unwinds back to runTasks(). Tests call it where the scheduler would have
+// let the task run, e.g. after poll() to collect what the TX task writes.
+namespace host {
+void runTasks();
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char* name, uint32_t stackDepth,
+                                   void* arg, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t core);
+void       xTaskNotifyGive(TaskHandle_t task);
+uint32_t   ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticksToWait);
+inline void vTaskDelay(TickType_t) {}
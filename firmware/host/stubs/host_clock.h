@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+// One clock behind millis() and esp_timer_get_time(). It only moves when a
+// test advances it, so timeouts in the code under test are deterministic.
+namespace host {
+int64_t nowUs();
+void advanceUs(int64_t us);
+}
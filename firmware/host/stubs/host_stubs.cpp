@@ -0,0 +1,77 @@
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "freertos/task.h"
+
+HostSerial Serial;
+LittleFSFS LittleFS;
+
+// Firmware objects are set up once and live until reset, so tests that
+// create them repeatedly would only report those as leaks
+extern "C" const char* __asan_default_options() { return "detect_leaks=0"; }
+
+namespace host {
+
+Flash flash;
+
+static int64_t s_nowUs = 0;
+
+int64_t nowUs() { return s_nowUs; }
+void advanceUs(int64_t us) { s_nowUs += us; }
+
+namespace {
+struct Task {
+    void (*fn)(void*);
+    void*    arg;
+    uint32_t notified;
+};
+struct TaskBlocked {};
+
+const int MAX_TASKS = 32;
+Task  s_tasks[MAX_TASKS];
+int   s_taskCount = 0;
+Task* s_current = nullptr;
+}
+
+// A task function is an endless loop around ulTaskNotifyTake(); running
+// it from the top again is the same as resuming it there
+void runTasks() {
+    bool ran = true;
+    while (ran) {
+        ran = false;
+        for (int i = 0; i < s_taskCount; i++) {
+            Task& t = s_tasks[i];
+            if (!t.notified) continue;
+            ran = true;
+            s_current = &t;
+            try {
+                t.fn(t.arg);
+            } catch (const TaskBlocked&) {
+            }
+            s_current = nullptr;
+        }
+    }
+}
+
+} // namespace host
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char*, uint32_t, void* arg,
+                                   UBaseType_t, TaskHandle_t* handle, BaseType_t) {
+    using namespace host;
+    if (s_taskCount == MAX_TASKS) return pdFALSE;
+    Task& t = s_tasks[s_taskCount++];
+    t = {fn, arg, 0};
+    if (handle) *handle = &t;
+    return pdPASS;
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    static_cast<host::Task*>(task)->notified++;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t) {
+    host::Task* t = host::s_current;
+    if (!t || !t->notified) throw host::TaskBlocked();
+    uint32_t n = t->notified;
+    t->notified = clearOnExit ? 0 : n - 1;
+    return n;
+}
@@ -0,0 +1,221 @@
+// AssetStore against the file-backed flash in stubs/LittleFS.h: round trips,
+// the PSRAM budget, reboots, corruption on flash, a reset during a write,
+// a full partition, and random bodies.
+#include <random>
+#include <string>
+#include <vector>
+#include <LittleFS.h>
+#include "mbedtls/sha256.h"
+#include "storage/asset_store.h"
+#include "check.h"
+
+// Relative to the working directory, which ctest sets to the build tree
+static const char* FLASH_DIR = "asset_store_flash";
+
+static std::mt19937 s_rng(7);
+
+struct Asset {
+    std::vector<uint8_t> body;
+    uint8_t hash[AssetStore::HASH_LEN];
+};
+
+static void hashBody(Asset& a) {
+    uint8_t digest[32];
+    mbedtls_sha256(a.body.data(), a.body.size(), digest, 0);
+    memcpy(a.hash, digest, AssetStore::HASH_LEN);
+}
+
+// Raw RGB565, [w(2), h(2), encoding, data]
+static Asset makeRaw(uint16_t w, uint16_t h) {
+    Asset a;
+    a.body = {(uint8_t)(w >> 8), (uint8_t)w, (uint8_t)(h >> 8), (uint8_t)h, 0};
+    for (uint32_t i = 0; i < (uint32_t)w * h * 2; i++) a.body.push_back(s_rng());
+    hashBody(a);
+    return a;
+}
+
+static bool put(AssetStore& s, const Asset& a) { return s.put(a.hash, a.body.data(), a.body.size()); }
+
+static bool shows(AssetStore& s, const Asset& a) {
+    AssetStore::Image im;
+    if (!s.get(a.hash, im)) return false;
+    uint16_t w = a.body[0] << 8 | a.body[1], h = a.body[2] << 8 | a.body[3];
+    return im.w == w && im.h == h && !memcmp(im.pixels, a.body.data() + 5, (size_t)w * h * 2);
+}
+
+static std::string pathOf(const Asset& a) {
+    static const char hex[] = "0123456789abcdef";
+    std::string path = std::string(FLASH_DIR) + "/";
+    for (uint8_t b : a.hash) {
+        path += hex[b >> 4];
+        path += hex[b & 0xF];
+    }
+    return path;
+}
+
+static void eraseFlash(size_t blocks) {
+    if (DIR* d = opendir(FLASH_DIR)) {
+        while (dirent* e = readdir(d)) {
+            if (strcmp(e->d_name, ".") && strcmp(e->d_name, "..")) {
+                unlink((std::string(FLASH_DIR) + "/" + e->d_name).c_str());
+            }
+        }
+        closedir(d);
+    }
+    host::flash.dir = FLASH_DIR;
+    host::flash.capacity = blocks * host::flash.block;
+    host::flash.failAfter = -1;
+}
+
+static void testSha256() {
+    static const struct {
+        const char* in;
+        uint8_t     first[4];
+    } vectors[] = {
+        {"", {0xe3, 0xb0, 0xc4, 0x42}},
+        {"abc", {0xba, 0x78, 0x16, 0xbf}},
+        {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", {0x24, 0x8d, 0x6a, 0x61}},
+    };
+    for (const auto& v : vectors) {
+        uint8_t digest[32];
+        CHECK(mbedtls_sha256((const uint8_t*)v.in, strlen(v.in), digest, 0) == 0);
+        CHECK(!memcmp(digest, v.first, 4));
+    }
+}
+
+// 32x32 raw assets are 2 KB decoded and one block on flash
+static void testRoundTripAndBudget(std::vector<Asset>& assets) {
+    eraseFlash(64);
+    for (int i = 0; i < 8; i++) assets.push_back(makeRaw(32, 32));
+
+    AssetStore s;
+    CHECK(s.begin(16 * 1024));
+    AssetStore::Image im;
+    CHECK(!s.get(assets[0].hash, im) && s.stats().misses == 1);
+    CHECK(put(s, assets[0]));
+    CHECK(shows(s, assets[0]) && s.stats().hits == 1);
+    CHECK(s.stats().stores == 1 && s.stats().files == 1);
+
+    // A body that doesn't match its hash is neither held nor stored
+    Asset bad = assets[1];
+    bad.hash[0] ^= 1;
+    CHECK(!put(s, bad) && s.stats().rejected == 1 && s.stats().files == 1);
+
+    // Bigger than the whole budget: refused without evicting anything
+    Asset huge = makeRaw(128, 128);
+    CHECK(!put(s, huge) && s.stats().rejected == 2 && s.stats().evictions == 0);
+
+    for (size_t i = 1; i < assets.size(); i++) CHECK(put(s, assets[i]));
+    CHECK(s.stats().entries == 8 && s.stats().bytes == 16 * 1024 && s.stats().evictions == 0);
+
+    // assets[0] is now the most recently used, so assets[1] goes
+    CHECK(shows(s, assets[0]));
+    Asset extra = makeRaw(32, 32);
+    CHECK(put(s, extra) && s.stats().evictions == 1);
+    uint32_t loads = s.stats().loads;
+    CHECK(shows(s, assets[1]) && s.stats().loads == loads + 1);
+    assets.push_back(extra);
+}
+
+static void testReboot(const std::vector<Asset>& assets) {
+    AssetStore s;
+    CHECK(s.begin(16 * 1024));
+    CHECK(s.stats().files == assets.size());
+    for (const Asset& a : assets) CHECK(shows(s, a));
+    CHECK(s.stats().loads == assets.size());
+}
+
+// A file that no longer matches its name is dropped and has to be sent again
+static void testCorruptFile(const std::vector<Asset>& assets) {
+    std::string path = pathOf(assets[2]);
+    FILE* f = fopen(path.c_str(), "r+b");
+    CHECK(f);
+    fseek(f, 100, SEEK_SET);
+    int c = fgetc(f);
+    fseek(f, 100, SEEK_SET);
+    fputc(c ^ 0x55, f);
+    fclose(f);
+
+    AssetStore s;
+    CHECK(s.begin(16 * 1024));
+    AssetStore::Image im;
+    CHECK(!s.get(assets[2].hash, im) && s.stats().rejected == 1);
+    CHECK(s.stats().files == assets.size() - 1 && access(path.c_str(), F_OK) != 0);
+    CHECK(put(s, assets[2]) && s.stats().files == assets.size());
+}
+
+// Reset part way through a write: nothing is left under the hash
+static void testInterruptedWrite(const std::vector<Asset>& assets) {
+    Asset a = makeRaw(32, 32);
+    AssetStore s;
+    CHECK(s.begin(16 * 1024));
+    host::flash.failAfter = 1000;
+    CHECK(put(s, a));  // Held decoded only
+    host::flash.failAfter = -1;
+    CHECK(s.stats().stores == 0 && s.stats().files == assets.size());
+
+    AssetStore rebooted;
+    CHECK(rebooted.begin(16 * 1024) && rebooted.stats().files == assets.size());
+    AssetStore::Image im;
+    CHECK(!rebooted.get(a.hash, im));
+}
+
+// Two superblocks, FLASH_RESERVE and eight one-block files fill twelve
+// blocks; the least recently used files make room for more
+static void testFlashFull() {
+    eraseFlash(12);
+    std::vector<Asset> assets;
+    for (int i = 0; i < 12; i++) assets.push_back(makeRaw(32, 32));
+
+    AssetStore s;
+    CHECK(s.begin(64 * 1024));
+    for (int i = 0; i < 8; i++) CHECK(put(s, assets[i]));
+    CHECK(s.stats().files == 8 && s.stats().flashEvictions == 0);
+    CHECK(shows(s, assets[0]));
+    for (int i = 8; i < 12; i++) CHECK(put(s, assets[i]));
+    CHECK(s.stats().files == 8 && s.stats().flashEvictions == 4);
+    CHECK(LittleFS.usedBytes() <= host::flash.capacity);
+
+    AssetStore rebooted;
+    CHECK(rebooted.begin(64 * 1024));
+    CHECK(shows(rebooted, assets[0]));
+    for (int i = 1; i < 5; i++) CHECK(!shows(rebooted, assets[i]));
+    for (int i = 5; i < 12; i++) CHECK(shows(rebooted, assets[i]));
+}
+
+// Random bodies under their own hash, so they all reach the decoder
+static void testRandomBodies() {
+    eraseFlash(256);
+    AssetStore s;
+    CHECK(s.begin(64 * 1024));
+    for (int it = 0; it < 20000; it++) {
+        Asset a;
+        a.body.resize(5 + s_rng() % 600);
+        for (uint8_t& b : a.body) b = s_rng();
+        a.body[0] = 0;
+        a.body[1] = s_rng() % 24;
+        a.body[2] = 0;
+        a.body[3] = s_rng() % 24;
+        a.body[4] = s_rng() % 3;
+        if (a.body[4] == 1 && a.body.size() >= 9 && s_rng() % 2) memcpy(&a.body[5], "qoif", 4);
+        hashBody(a);
+        bool held = put(s, a);
+        AssetStore::Image im;
+        CHECK(s.get(a.hash, im) == held);
+        CHECK(s.stats().bytes <= 64 * 1024);
+    }
+}
+
+int main() {
+    testSha256();
+    std::vector<Asset> assets;
+    testRoundTripAndBudget(assets);
+    testReboot(assets);
+    testCorruptFile(assets);
+    testInterruptedWrite(assets);
+    testFlashFull();
+    testRandomBodies();
+    eraseFlash(0);
+    puts("test_asset_store ok");
+    return 0;
+}
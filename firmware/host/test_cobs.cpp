@@ -0,0 +1,191 @@
+// COBS: the streaming encoder against a one-shot reference, in-place
+// decoding, and how the receive path recovers from corrupted COBS frames
+// next to v1 frames under the same damage.
+#include <Arduino.h>
+#include <random>
+#include <set>
+#include <vector>
+#include "comms/serial_comms.h"
+#include "check.h"
+
+static std::mt19937 s_rng(5);
+
+// Textbook encoder: whole frame at once
+static std::vector<uint8_t> encodeReference(const std::vector<uint8_t>& in) {
+    std::vector<uint8_t> out(1);
+    size_t codeIdx = 0;
+    uint8_t code = 1;
+    for (uint8_t b : in) {
+        if (b) {
+            out.push_back(b);
+            code++;
+        }
+        if (!b || code == 0xFF) {
+            out[codeIdx] = code;
+            codeIdx = out.size();
+            out.push_back(0);
+            code = 1;
+        }
+    }
+    out[codeIdx] = code;
+    return out;
+}
+
+static void testCodec() {
+    for (int it = 0; it < 20000; it++) {
+        // Mostly short, some across the 254-byte block limit, zeros sparse or dense
+        size_t len = it % 10 ? s_rng() % 300 : s_rng() % 2000;
+        uint32_t zeroOdds = 1 + s_rng() % 300;
+        std::vector<uint8_t> data(len);
+        for (uint8_t& b : data) b = s_rng() % zeroOdds ? 1 + s_rng() % 255 : 0;
+
+        std::vector<uint8_t> enc(cobs::maxEncodedLen(len));
+        cobs::Encoder encoder(enc.data());
+        for (size_t pos = 0; pos < len;) {
+            size_t n = std::min<size_t>(len - pos, 1 + s_rng() % 64);
+            encoder.put(data.data() + pos, n);
+            pos += n;
+        }
+        enc.resize(encoder.finish());
+        CHECK(enc == encodeReference(data));
+        CHECK(enc.size() <= cobs::maxEncodedLen(len));
+        for (uint8_t b : enc) CHECK(b != 0);
+
+        size_t outLen = 0;
+        CHECK(cobs::decode(enc.data(), enc.size(), enc.data(), &outLen));
+        CHECK(outLen == len && std::equal(data.begin(), data.end(), enc.begin()));
+    }
+
+    // Code bytes that point past the end, or zero, are malformed
+    const uint8_t truncated[] = {0x05, 'a', 'b'};
+    const uint8_t zero[] = {0x02, 'a', 0x00, 'b'};
+    size_t outLen;
+    uint8_t out[8];
+    CHECK(!cobs::decode(truncated, sizeof(truncated), out, &outLen));
+    CHECK(!cobs::decode(zero, sizeof(zero), out, &outLen));
+}
+
+static std::set<uint32_t> s_seen;
+static uint32_t s_sent;       // Frames fed so far
+static uint32_t s_maxDelay;   // Most frames sent after one before it was delivered
+static uint32_t s_delayed;    // Frames delivered only after a later one was sent
+static void onText(const msg::DisplayText& m) {
+    uint32_t index;
+    CHECK(m.len >= sizeof(index));
+    memcpy(&index, m.text, sizeof(index));
+    s_seen.insert(index);
+    uint32_t delay = s_sent - 1 - index;
+    if (delay > 0) s_delayed++;
+    if (delay > s_maxDelay) s_maxDelay = delay;
+}
+
+enum Damage { FLIP, DROP, INSERT, DROP_DELIMITER };
+
+struct Recovery {
+    size_t   damaged = 0;      // Frames hit by an error
+    size_t   lost = 0;         // Frames not delivered
+    size_t   collateral = 0;   // Undamaged frames not delivered
+    uint32_t delayed = 0;      // Frames held up until more bytes arrived
+    uint32_t maxDelay = 0;     // In frames sent meanwhile
+};
+
+// Sends FRAMES text frames, damaging one in ten, and polls without
+// advancing the clock: anything recovered is recovered without waiting
+// for FRAME_TIMEOUT_MS. Paced, each frame is polled on its own, as when
+// the host sends one and waits for the screen to update; a frame the
+// parser holds back until later bytes arrive counts as delayed.
+static Recovery sendDamaged(bool cobsMode, Damage damage, bool paced) {
+    const uint32_t FRAMES = 2000;
+    SerialComms comms;
+    comms.begin();
+    comms.on(onText);
+    Serial.reset();
+    if (cobsMode) {
+        uint8_t hello[2] = {protocol::VERSION_2, protocol::FEATURE_COBS};
+        uint8_t f[16];
+        Serial.feed(f, protocol::buildFrame(f, MSG_HELLO, hello, sizeof(hello)));
+        comms.poll();
+        host::runTasks();
+        CHECK(comms.cobsFraming());
+    }
+
+    std::vector<std::vector<uint8_t>> frames;
+    std::set<uint32_t> damaged;
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        uint8_t payload[64];
+        memcpy(payload, &i, sizeof(i));
+        size_t len = sizeof(i) + s_rng() % 60;
+        for (size_t k = sizeof(i); k < len; k++) payload[k] = 'a' + s_rng() % 26;
+        std::vector<uint8_t> f(protocol::MAX_FRAME_LEN);
+        f.resize(cobsMode ? protocol::buildCobsFrame(f.data(), MSG_DISPLAY_TEXT, payload, len)
+                          : protocol::buildFrame(f.data(), MSG_DISPLAY_TEXT, payload, len, protocol::VERSION_2));
+        if (i % 10 == 5) {
+            damaged.insert(i);
+            // Damage lands anywhere but the delimiter, unless that is the point
+            size_t at = s_rng() % (f.size() - 1);
+            switch (damage) {
+            case FLIP:   f[at] ^= 1 << s_rng() % 8; break;
+            case DROP:   f.erase(f.begin() + at); break;
+            case INSERT: f.insert(f.begin() + at, (uint8_t)(1 + s_rng() % 255)); break;
+            case DROP_DELIMITER:
+                f.pop_back();
+                if (cobsMode) damaged.insert(i + 1);  // Runs into the next frame
+                break;
+            }
+        }
+        frames.push_back(f);
+    }
+
+    s_seen.clear();
+    s_sent = 0;
+    s_delayed = 0;
+    s_maxDelay = 0;
+    Serial.rxChunk = 64;
+    for (const std::vector<uint8_t>& f : frames) {
+        Serial.feed(f);
+        s_sent++;
+        if (paced) comms.poll();
+    }
+    while (Serial.available()) comms.poll();
+    Serial.rxChunk = 0;
+
+    Recovery r;
+    r.damaged = damaged.size();
+    r.delayed = paced ? s_delayed : 0;
+    r.maxDelay = paced ? s_maxDelay : 0;
+    for (uint32_t i = 0; i < FRAMES; i++) {
+        if (s_seen.count(i)) continue;
+        r.lost++;
+        if (!damaged.count(i)) r.collateral++;
+    }
+    return r;
+}
+
+static void testRecovery() {
+    static const char* const kNames[] = {"byte flipped", "byte dropped", "byte inserted", "delimiter dropped"};
+    for (bool paced : {false, true}) {
+        printf("%s\n", paced ? "one frame per poll:" : "back to back:");
+        for (Damage damage : {FLIP, DROP, INSERT, DROP_DELIMITER}) {
+            Recovery c = sendDamaged(true, damage, paced);
+            // COBS loses exactly the frames an error touched, and delivers
+            // the next one as soon as it has arrived
+            CHECK(c.collateral == 0 && c.lost <= c.damaged);
+            CHECK(c.delayed == 0);
+            printf("  %-18s cobs: %3zu damaged %3zu lost %3u delayed", kNames[damage],
+                   c.damaged, c.lost, c.delayed);
+            if (damage != DROP_DELIMITER) {  // v2 has no delimiter
+                Recovery v = sendDamaged(false, damage, paced);
+                printf("   v2: %3zu damaged %3zu lost %3u delayed (by up to %u frames)",
+                       v.damaged, v.lost, v.delayed, v.maxDelay);
+            }
+            printf("\n");
+        }
+    }
+}
+
+int main() {
+    testCodec();
+    testRecovery();
+    puts("test_cobs ok");
+    return 0;
+}
@@ -0,0 +1,90 @@
+// FrameProfiler and its STATS_FRAME_PROFILE payload: the ring and paging
+// through it, then a reader on another thread while frames are committed,
+// as the comms task reads it while the LVGL task records.
+#include <atomic>
+#include <thread>
+#include "util/stats_codec.h"
+#include "check.h"
+
+// Every field of a record made from seq carries seq, so a torn copy shows
+static void commitFrame(FrameProfiler& prof, uint32_t seq) {
+    prof.begin(seq, seq);
+    FrameRecord& r = prof.current();
+    r.rotateUs = r.drawBitmapUs = r.flushWaitUs = r.areaPx = seq;
+    r.areas = (uint16_t)seq;
+    prof.commit(seq * 4);
+}
+
+static bool consistent(const FrameRecord& r) {
+    return r.startUs == r.seq && r.lockWaitUs == r.seq && r.rotateUs == r.seq &&
+           r.drawBitmapUs == r.seq && r.flushWaitUs == r.seq && r.areaPx == r.seq &&
+           r.areas == (uint16_t)r.seq && r.totalUs == r.seq * 4 && r.renderUs == r.seq;
+}
+
+static void testRing() {
+    static FrameProfiler prof;
+    FrameRecord r;
+    CHECK(prof.firstSeq() == 0 && prof.nextSeq() == 0 && !prof.read(0, r));
+    for (uint32_t i = 0; i < FrameProfiler::RECORDS + 6; i++) commitFrame(prof, i);
+    CHECK(prof.firstSeq() == 6 && prof.nextSeq() == FrameProfiler::RECORDS + 6);
+    CHECK(!prof.read(5, r) && !prof.read(prof.nextSeq(), r));
+    CHECK(prof.read(6, r) && r.seq == 6 && consistent(r));
+
+    // Paged out from 0: the first page starts at the oldest held, and
+    // following first_seq + count walks to the end without a gap
+    uint8_t buf[protocol::FRAME_PROFILE_HEADER_LEN + 10 * protocol::FRAME_RECORD_LEN];
+    uint32_t since = 0, seen = 0;
+    for (;;) {
+        uint16_t len = protocol::putFrameRecords(buf, sizeof(buf), prof, since);
+        uint32_t first = protocol::getLe32(buf);
+        uint8_t count = buf[8];
+        CHECK(len == protocol::FRAME_PROFILE_HEADER_LEN + count * protocol::FRAME_RECORD_LEN);
+        CHECK(protocol::getLe32(buf + 4) == prof.nextSeq());
+        CHECK(first == (since > 6 ? since : 6));
+        for (uint8_t i = 0; i < count; i++) {
+            CHECK(protocol::getLe32(buf + protocol::FRAME_PROFILE_HEADER_LEN +
+                                    i * protocol::FRAME_RECORD_LEN) == first + i);
+        }
+        seen += count;
+        if (count == 0) break;
+        since = first + count;
+    }
+    CHECK(seen == FrameProfiler::RECORDS);
+}
+
+static void testConcurrentReader() {
+    static FrameProfiler prof;
+    std::atomic<bool> done{false};
+    std::atomic<uint32_t> committed{0};
+    std::thread lvgl([&] {
+        for (uint32_t seq = 0; !done; seq++) {
+            commitFrame(prof, seq);
+            committed = seq + 1;
+            if (seq % 16 == 0) std::this_thread::yield();
+        }
+    });
+
+    uint32_t read = 0;
+    for (int pass = 0; pass < 20000; pass++) {
+        uint32_t first = prof.firstSeq();
+        for (uint32_t seq = first; seq < first + FrameProfiler::RECORDS; seq++) {
+            FrameRecord r;
+            if (!prof.read(seq, r)) continue;
+            CHECK(r.seq == seq && consistent(r));
+            read++;
+        }
+        if (pass % 16 == 0) std::this_thread::yield();
+    }
+    done = true;
+    lvgl.join();
+    CHECK(read > 0);
+    printf("test_frame_profiler: %u records read while %u frames were committed\n", read,
+           committed.load());
+}
+
+int main() {
+    testRing();
+    testConcurrentReader();
+    puts("test_frame_profiler ok");
+    return 0;
+}
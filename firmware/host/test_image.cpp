@@ -0,0 +1,107 @@
+// MSG_IMAGE decoders: QOI against hand-assembled reference bytes that use
+// every op, round trips through the reference encoder, truncated streams
+// and corrupt input.
+#include <random>
+#include <vector>
+#include "display/image_decoder.h"
+#include "check.h"
+#include "qoi_encode.h"
+
+// 4x2, RGB. Pixel hashes (r*3 + g*5 + b*7 + a*11) % 64 are noted where
+// the stream relies on them.
+static const uint8_t kGolden[] = {
+    'q', 'o', 'i', 'f', 0, 0, 0, 4, 0, 0, 0, 2, 3, 0,
+    0xFE, 0x10, 0x20, 0x30,        // OP_RGB   (10 20 30)           slot 21
+    0x76,                          // OP_DIFF  +1 -1 +0 → (11 1f 30)
+    0xA8, 0xA5,                    // OP_LUMA  dg +8, dr-dg +2, db-dg -3 → (1b 27 35)
+    0xFF, 0xF0, 0x80, 0x08, 0x40,  // OP_RGBA  (f0 80 08), alpha dropped
+    0x15,                          // OP_INDEX 21 → (10 20 30)
+    0xC2,                          // OP_RUN   3
+    0, 0, 0, 0, 0, 0, 0, 1,
+};
+static const uint16_t kGoldenPixels[] = {
+    0x1106, 0x10E6, 0x1926, 0xF401,
+    0x1106, 0x1106, 0x1106, 0x1106,
+};
+
+static void testGolden() {
+    uint16_t out[8] = {};
+    CHECK(image::decodeQoi(kGolden, sizeof(kGolden), out, 4, 2) == 2);
+    CHECK(!memcmp(out, kGoldenPixels, sizeof(out)));
+
+    // Cut inside the second row: only the first comes back
+    uint16_t partial[8] = {};
+    CHECK(image::decodeQoi(kGolden, 14 + 4 + 1 + 2 + 5, partial, 4, 2) == 1);
+    CHECK(!memcmp(partial, kGoldenPixels, 4 * sizeof(uint16_t)));
+
+    // An image taller than the room for it is refused outright
+    uint16_t oneRow[4] = {};
+    CHECK(image::decodeQoi(kGolden, sizeof(kGolden), oneRow, 4, 1) == 0);
+
+    // Width must match the header
+    CHECK(image::decodeQoi(kGolden, sizeof(kGolden), out, 3, 2) == 0);
+}
+
+static void testRaw() {
+    const uint8_t data[] = {0x06, 0x11, 0xE6, 0x10, 0x26, 0x19, 0x01, 0xF4, 0xAA};
+    uint16_t out[4] = {};
+    CHECK(image::decodeRaw(data, 8, out, 2, 4) == 2);
+    CHECK(!memcmp(out, kGoldenPixels, sizeof(out)));
+    CHECK(image::decodeRaw(data, sizeof(data), out, 4, 4) == 1);  // Whole rows only
+    CHECK(image::decodeRaw(data, 8, out, 2, 1) == 1);
+}
+
+static void testRoundTrip() {
+    std::mt19937 rng(9);
+    for (int it = 0; it < 2000; it++) {
+        uint32_t w = 1 + rng() % 64, h = 1 + rng() % 64;
+        uint8_t channels = rng() % 2 ? 3 : 4;
+        // Flat areas, gradients and noise, so every op turns up
+        std::vector<qoi::Pixel> px(w * h);
+        qoi::Pixel c = {(uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), 255};
+        for (qoi::Pixel& p : px) {
+            switch (rng() % 6) {
+            case 0: c = {(uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng(), (uint8_t)rng()}; break;
+            case 1: c.r += rng() % 3 - 1; c.b += rng() % 3 - 1; break;
+            case 2: c.g += rng() % 40 - 20; c.r += rng() % 9 - 4; break;
+            default: break;
+            }
+            p = c;
+        }
+        std::vector<uint8_t> stream = qoi::encode(px, w, h, channels);
+        std::vector<uint16_t> out(w * h);
+        CHECK(image::decodeQoi(stream.data(), stream.size(), out.data(), w, h) == h);
+        for (size_t i = 0; i < px.size(); i++) CHECK(out[i] == image::rgb565(px[i].r, px[i].g, px[i].b));
+
+        // Any prefix decodes to whole rows of the same pixels
+        uint32_t cut = rng() % stream.size();
+        std::vector<uint16_t> part(w * h, 0);
+        uint16_t rows = image::decodeQoi(stream.data(), cut, part.data(), w, h);
+        CHECK(rows <= h);
+        CHECK(!memcmp(part.data(), out.data(), (size_t)rows * w * 2));
+    }
+}
+
+// Corrupt streams may decode to anything but must stay in the buffer
+static void testCorrupt() {
+    std::mt19937 rng(4);
+    for (int it = 0; it < 20000; it++) {
+        uint32_t w = 1 + rng() % 32, h = 1 + rng() % 32;
+        std::vector<qoi::Pixel> px(w * h);
+        for (qoi::Pixel& p : px) p = {(uint8_t)(rng() % 4), (uint8_t)rng(), 7, 255};
+        std::vector<uint8_t> stream = qoi::encode(px, w, h, 3);
+        for (int k = 1 + rng() % 3; k > 0; k--) stream[14 + rng() % (stream.size() - 14)] = rng();
+        uint16_t maxRows = rng() % 2 ? h : 1 + rng() % h;
+        std::vector<uint16_t> out((size_t)w * maxRows);
+        CHECK(image::decodeQoi(stream.data(), stream.size(), out.data(), w, maxRows) <= maxRows);
+    }
+}
+
+int main() {
+    testGolden();
+    testRaw();
+    testRoundTrip();
+    testCorrupt();
+    puts("test_image ok");
+    return 0;
+}
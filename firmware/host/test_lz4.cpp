@@ -0,0 +1,117 @@
+// LZ4: the incremental decoder against the host compressor, fed in pieces
+// of every size, corrupt input, and compressed fragments through poll().
+#include <Arduino.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "comms/serial_comms.h"
+#include "check.h"
+#include "lz4_compress.h"
+
+static std::mt19937 s_rng(11);
+
+static std::string randomText(size_t len) {
+    static const char* const kWords[] = {"the ", "tool ", "output ", "error: ", "src/file.ts:12 ", "  ",
+                                         "\n", "function ", "return ", "const x = 42;\n"};
+    std::string s;
+    while (s.size() < len) {
+        if (s_rng() % 5 == 0) s += (char)s_rng();
+        else s += kWords[s_rng() % 10];
+    }
+    s.resize(len);
+    return s;
+}
+
+static void testRoundTrip() {
+    for (int it = 0; it < 3000; it++) {
+        std::string text = it % 7 ? randomText(s_rng() % 8000) : std::string(s_rng() % 3000, 'a');
+        std::vector<uint8_t> packed = lz4::compress((const uint8_t*)text.data(), text.size());
+
+        // Exact-size output, so ASan catches a write past it
+        std::vector<uint8_t> out(text.size());
+        Lz4StreamDecoder dec;
+        dec.begin(out.data(), out.size());
+        for (size_t pos = 0; pos < packed.size();) {
+            size_t n = std::min<size_t>(packed.size() - pos, it % 3 ? 1 + s_rng() % 200 : 1);
+            CHECK(dec.feed(packed.data() + pos, n));
+            pos += n;
+        }
+        CHECK(dec.produced() == text.size() && dec.atBoundary());
+        CHECK(!memcmp(out.data(), text.data(), text.size()));
+    }
+}
+
+// Corrupt input may decode to garbage or be rejected, but must stay
+// inside the output buffer
+static void testCorrupt() {
+    size_t rejected = 0;
+    for (int it = 0; it < 20000; it++) {
+        std::string text = randomText(1 + s_rng() % 2000);
+        std::vector<uint8_t> packed = lz4::compress((const uint8_t*)text.data(), text.size());
+        for (int k = 1 + s_rng() % 4; k > 0; k--) packed[s_rng() % packed.size()] = s_rng();
+        std::vector<uint8_t> out(text.size());
+        Lz4StreamDecoder dec;
+        dec.begin(out.data(), out.size());
+        bool ok = dec.feed(packed.data(), packed.size());
+        CHECK(dec.produced() <= out.size());
+        rejected += !ok;
+    }
+    CHECK(rejected > 0);
+}
+
+static std::string s_text;
+static void onText(const msg::DisplayText& m) { s_text.assign(m.text, m.len); }
+
+static std::vector<std::vector<uint8_t>> fragments(uint8_t msgId, const std::string& text, uint8_t codec) {
+    std::vector<uint8_t> data = codec == protocol::CODEC_LZ4
+        ? lz4::compress((const uint8_t*)text.data(), text.size())
+        : std::vector<uint8_t>(text.begin(), text.end());
+    const size_t PER_FRAGMENT = MAX_MSG_LEN - 1 - FragmentAssembler::HEADER_LEN;
+    std::vector<std::vector<uint8_t>> out;
+    for (size_t pos = 0, index = 0; pos < data.size(); pos += PER_FRAGMENT, index++) {
+        size_t n = std::min(PER_FRAGMENT, data.size() - pos);
+        std::vector<uint8_t> payload = {msgId, (uint8_t)index, MSG_DISPLAY_TEXT, codec,
+                                        (uint8_t)(text.size() >> 8), (uint8_t)text.size()};
+        payload.insert(payload.end(), data.begin() + pos, data.begin() + pos + n);
+        std::vector<uint8_t> f(protocol::MAX_FRAME_LEN);
+        f.resize(protocol::buildFrame(f.data(), MSG_FRAGMENT, payload.data(), payload.size(), protocol::VERSION_2));
+        out.push_back(f);
+    }
+    return out;
+}
+
+static void testFragments() {
+    SerialComms comms;
+    comms.begin();
+    comms.on(onText);
+    Serial.reset();
+    for (uint8_t codec : {protocol::CODEC_RAW, protocol::CODEC_LZ4}) {
+        std::string text = randomText(MAX_REASSEMBLED_LEN);
+        std::vector<std::vector<uint8_t>> frags = fragments(1, text, codec);
+        CHECK(frags.size() > 1);
+
+        s_text.clear();
+        for (const auto& f : frags) Serial.feed(f);
+        comms.poll();
+        CHECK(s_text == text);
+
+        // A missing fragment drops the message, and the next one still arrives
+        s_text.clear();
+        for (size_t i = 0; i < frags.size(); i++) {
+            if (i != 1) Serial.feed(frags[i]);
+        }
+        comms.poll();
+        CHECK(s_text.empty());
+        for (const auto& f : fragments(2, "short", codec)) Serial.feed(f);
+        comms.poll();
+        CHECK(s_text == "short");
+    }
+}
+
+int main() {
+    testRoundTrip();
+    testCorrupt();
+    testFragments();
+    puts("test_lz4 ok");
+    return 0;
+}
@@ -0,0 +1,196 @@
+// Protocol v2: CRC-32 against a bitwise reference, v2 frames through
+// poll(), MSG_HELLO version negotiation, v1 frames after v2 was selected
+// and when the framing switches.
+#include <Arduino.h>
+#include <vector>
+#include "comms/serial_comms.h"
+#include "check.h"
+
+// IEEE 802.3 CRC-32, reflected, one bit at a time
+static uint32_t crc32Bitwise(const uint8_t* p, size_t len) {
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+static void testCrc() {
+    CHECK(protocol::crc32((const uint8_t*)"123456789", 9) == 0xCBF43926);
+    CHECK(protocol::crc32(nullptr, 0) == 0);
+
+    std::vector<uint8_t> data(1100);
+    for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(i * 167 + 13);
+    // Every length through the slicing loop and its byte tail, at every alignment
+    for (size_t offset = 0; offset < 8; offset++) {
+        for (size_t len = 0; len + offset <= data.size(); len += len < 64 ? 1 : 37) {
+            CHECK(protocol::crc32(data.data() + offset, len) == crc32Bitwise(data.data() + offset, len));
+        }
+    }
+    // Incremental updates compose
+    for (size_t split = 0; split <= 300; split += 7) {
+        uint32_t crc = protocol::crc32Update(0, data.data(), split);
+        CHECK(protocol::crc32Update(crc, data.data() + split, 300 - split) == protocol::crc32(data.data(), 300));
+    }
+}
+
+static std::vector<uint8_t> s_texts;
+static void onText(const msg::DisplayText& m) { s_texts.assign(m.text, m.text + m.len); }
+
+static std::vector<uint8_t> frame(uint8_t type, const std::vector<uint8_t>& payload, uint8_t version) {
+    std::vector<uint8_t> out(protocol::MAX_FRAME_LEN);
+    out.resize(protocol::buildFrame(out.data(), type, payload.data(), payload.size(), version));
+    return out;
+}
+
+// Two bit flips in the same column cancel in the XOR checksum; CRC-32 catches them
+static void testV2Frames() {
+    SerialComms comms;
+    comms.begin();
+    comms.on(onText);
+    Serial.reset();
+
+    std::vector<uint8_t> text(200, 'x');
+    std::vector<uint8_t> v1 = frame(MSG_DISPLAY_TEXT, text, protocol::VERSION_1);
+    std::vector<uint8_t> v2 = frame(MSG_DISPLAY_TEXT, text, protocol::VERSION_2);
+    CHECK(v2.size() == text.size() + 1 + protocol::FRAME_OVERHEAD_V2);
+    v1[20] ^= 0x04; v1[90] ^= 0x04;
+    v2[20] ^= 0x04; v2[90] ^= 0x04;
+
+    s_texts.clear();
+    Serial.feed(v2);
+    comms.poll();
+    CHECK(s_texts.empty() && comms.linkStats().rxBadFrames == 1);
+    Serial.feed(v1);
+    comms.poll();
+    CHECK(s_texts.size() == text.size());  // Accepted, corrupted
+
+    // A clean v2 frame right after the bad one still gets through
+    s_texts.clear();
+    Serial.feed(frame(MSG_DISPLAY_TEXT, text, protocol::VERSION_2));
+    comms.poll();
+    CHECK(s_texts == text);
+}
+
+// The reply goes out in v1 framing so any host can read it, and
+// device→host frames switch to the selected version afterwards
+static void testHello() {
+    struct Case { std::vector<uint8_t> hello; uint8_t selected; };
+    const Case cases[] = {
+        {{}, protocol::VERSION_1},                           // v1 host, no payload
+        {{protocol::VERSION_1}, protocol::VERSION_1},
+        {{protocol::VERSION_2}, protocol::VERSION_2},
+        {{7, 0}, protocol::VERSION_2},                       // Newer host: highest we both speak
+    };
+    for (const Case& c : cases) {
+        SerialComms comms;
+        comms.begin();
+        Serial.reset();
+        Serial.feed(frame(MSG_HELLO, c.hello, protocol::VERSION_1));
+        comms.poll();
+        host::runTasks();
+        uint8_t reply[3] = {protocol::SUPPORTED_VERSIONS, c.selected, 0};
+        std::vector<uint8_t> expected = frame(MSG_HELLO, {reply, reply + 3}, protocol::VERSION_1);
+        CHECK(Serial.tx == expected);
+        CHECK(comms.protocolVersion() == c.selected);
+
+        Serial.tx.clear();
+        comms.sendHeartbeat(1);
+        host::runTasks();
+        CHECK(Serial.tx == frame(MSG_HEARTBEAT, {1}, c.selected));
+    }
+}
+
+// Once v2 is selected only a v1 MSG_HELLO gets through in v1 framing; it
+// can take the link back to v1
+static void testV1AfterV2() {
+    SerialComms comms;
+    comms.begin();
+    comms.on(onText);
+    Serial.reset();
+    Serial.feed(frame(MSG_HELLO, {protocol::VERSION_2}, protocol::VERSION_1));
+    comms.poll();
+    host::runTasks();
+
+    std::vector<uint8_t> text = {'h', 'i'};
+    s_texts.clear();
+    uint32_t bad = comms.linkStats().rxBadFrames;
+    Serial.feed(frame(MSG_DISPLAY_TEXT, text, protocol::VERSION_1));
+    comms.poll();
+    CHECK(s_texts.empty() && comms.linkStats().rxBadFrames == bad + 1);
+    Serial.feed(frame(MSG_DISPLAY_TEXT, text, protocol::VERSION_2));
+    comms.poll();
+    CHECK(s_texts == text);
+
+    Serial.tx.clear();
+    Serial.feed(frame(MSG_HELLO, {protocol::VERSION_1}, protocol::VERSION_1));
+    comms.poll();
+    host::runTasks();
+    uint8_t reply[3] = {protocol::SUPPORTED_VERSIONS, protocol::VERSION_1, 0};
+    CHECK(Serial.tx == frame(MSG_HELLO, {reply, reply + 3}, protocol::VERSION_1));
+    s_texts.clear();
+    Serial.feed(frame(MSG_DISPLAY_TEXT, text, protocol::VERSION_1));
+    comms.poll();
+    CHECK(s_texts == text);
+}
+
+static std::vector<uint8_t> cobsFrame(uint8_t type, const std::vector<uint8_t>& payload) {
+    std::vector<uint8_t> out(protocol::MAX_FRAME_LEN);
+    out.resize(protocol::buildCobsFrame(out.data(), type, payload.data(), payload.size()));
+    return out;
+}
+
+// Device→host framing switches where the host sees the reply. A button
+// event the input task queues before the TX task has written the reply
+// goes out ahead of it (the high lane drains first) in the old framing;
+// one queued after it uses the new one. A bridge timeout goes back to v1.
+static void testHelloOrdering() {
+    SerialComms comms;
+    comms.begin();
+    Serial.reset();
+    host::advanceUs(1000000);  // Message times of 0 mean none yet
+    const uint8_t features = protocol::FEATURE_COBS | protocol::FEATURE_BUTTON_TIME;
+    Serial.feed(frame(MSG_HELLO, {protocol::VERSION_2, features}, protocol::VERSION_1));
+    comms.poll();
+    comms.sendButtonEvent(3, true, host::nowUs());
+    CHECK(comms.protocolVersion() == protocol::VERSION_1 && !comms.cobsFraming());
+    host::runTasks();
+
+    std::vector<uint8_t> expected = frame(MSG_BUTTON, {3, 1}, protocol::VERSION_1);
+    std::vector<uint8_t> reply = frame(MSG_HELLO, {protocol::SUPPORTED_VERSIONS, protocol::VERSION_2,
+                                                   features}, protocol::VERSION_1);
+    expected.insert(expected.end(), reply.begin(), reply.end());
+    CHECK(Serial.tx == expected);
+    CHECK(comms.protocolVersion() == protocol::VERSION_2 && comms.cobsFraming());
+
+    Serial.tx.clear();
+    int64_t edgeUs = host::nowUs();
+    host::advanceUs(250);
+    comms.sendButtonEvent(3, false, edgeUs);
+    host::runTasks();
+    std::vector<uint8_t> ex(14);
+    ex[0] = 3;
+    ex[1] = 0;
+    protocol::putLe64(ex.data() + 2, (uint64_t)edgeUs);
+    protocol::putLe32(ex.data() + 10, 250);
+    CHECK(Serial.tx == cobsFrame(MSG_BUTTON_EX, ex));
+
+    Serial.tx.clear();
+    host::advanceUs(16000000);
+    comms.poll();
+    comms.sendHeartbeat(1);
+    host::runTasks();
+    CHECK(comms.protocolVersion() == protocol::VERSION_1 && !comms.cobsFraming());
+    CHECK(Serial.tx == frame(MSG_HEARTBEAT, {1}, protocol::VERSION_1));
+}
+
+int main() {
+    testCrc();
+    testV2Frames();
+    testHello();
+    testV1AfterV2();
+    testHelloOrdering();
+    puts("test_protocol ok");
+    return 0;
+}
@@ -0,0 +1,168 @@
+// FEATURE_RELIABLE: MSG_ACK goes out even when the bulk lane is full, an
+// ACK not yet written is replaced by a newer one, and the go-back-N
+// reference host in reliable_host.h gets every message through a link
+// that loses and corrupts frames both ways, exactly once and in order.
+#include <Arduino.h>
+#include <random>
+#include <string>
+#include <vector>
+#include "comms/serial_comms.h"
+#include "reliable_host.h"
+#include "check.h"
+
+struct Frame {
+    uint8_t type;
+    std::vector<uint8_t> payload;
+};
+
+// Start-byte frames the device wrote, in order; the tx buffer is consumed
+static std::vector<Frame> deviceFrames() {
+    std::vector<Frame> out;
+    std::vector<uint8_t>& tx = Serial.tx;
+    size_t pos = 0;
+    while (pos + 3 <= tx.size()) {
+        uint16_t bodyLen = tx[pos + 1] << 8 | tx[pos + 2];
+        uint8_t version = tx[pos] == FRAME_START_BYTE_V2 ? protocol::VERSION_2 : protocol::VERSION_1;
+        size_t frameLen = bodyLen + protocol::frameOverhead(version);
+        CHECK(pos + frameLen <= tx.size() && protocol::verifyFrame(&tx[pos], bodyLen));
+        out.push_back({tx[pos + 3], {&tx[pos + 4], &tx[pos + 3 + bodyLen]}});
+        pos += frameLen;
+    }
+    CHECK(pos == tx.size());
+    tx.clear();
+    return out;
+}
+
+// [SEQ] [MSG_TYPE] [PAYLOAD...] in a v2 frame; buildFrame puts its type
+// byte first, so SEQ goes there
+static std::vector<uint8_t> seqFrame(uint8_t seq, uint8_t type, const std::vector<uint8_t>& payload = {}) {
+    std::vector<uint8_t> body{type};
+    body.insert(body.end(), payload.begin(), payload.end());
+    std::vector<uint8_t> out(protocol::MAX_FRAME_LEN);
+    out.resize(protocol::buildFrame(out.data(), seq, body.data(), body.size(), protocol::VERSION_2));
+    return out;
+}
+
+static void startReliable(SerialComms& comms) {
+    comms.begin();
+    Serial.reset();
+    uint8_t hello[2] = {protocol::VERSION_2, protocol::FEATURE_RELIABLE};
+    std::vector<uint8_t> f(protocol::MAX_FRAME_LEN);
+    f.resize(protocol::buildFrame(f.data(), MSG_HELLO, hello, sizeof(hello), protocol::VERSION_1));
+    Serial.feed(f);
+    comms.poll();
+    host::runTasks();
+    std::vector<Frame> reply = deviceFrames();
+    CHECK(reply.size() == 1 && reply[0].type == MSG_HELLO);
+    CHECK(reply[0].payload[2] == protocol::FEATURE_RELIABLE);
+}
+
+static int s_clears = 0;
+static void onClear(const msg::Clear&) { s_clears++; }
+
+// Heartbeats fill the bulk lane before the TX task gets to run; the ACK
+// for the frame received meanwhile must not be dropped with the overflow
+static void testAckWithFullBulkLane() {
+    SerialComms comms;
+    comms.on(onClear);
+    startReliable(comms);
+
+    uint32_t dropped = comms.txDropped(SerialComms::TX_LANE_BULK);
+    for (int i = 0; comms.txDropped(SerialComms::TX_LANE_BULK) == dropped; i++) {
+        comms.sendHeartbeat((uint8_t)i);
+    }
+    s_clears = 0;
+    Serial.feed(seqFrame(0, MSG_CLEAR));
+    comms.poll();
+    CHECK(s_clears == 1);
+    host::runTasks();
+
+    int heartbeats = 0, acks = 0;
+    for (const Frame& f : deviceFrames()) {
+        if (f.type == MSG_HEARTBEAT) heartbeats++;
+        if (f.type != MSG_ACK) continue;
+        acks++;
+        CHECK(f.payload.size() == 3 && f.payload[0] == 0);
+        CHECK((f.payload[1] << 8 | f.payload[2]) > 0);  // Credit
+    }
+    CHECK(heartbeats > 0 && acks == 1);
+    CHECK(comms.linkStats().acksSent == 1);
+}
+
+// Two polls before the TX task runs: only the later, cumulative ACK is written
+static void testAckSuperseded() {
+    SerialComms comms;
+    comms.on(onClear);
+    startReliable(comms);
+
+    Serial.feed(seqFrame(0, MSG_CLEAR));
+    comms.poll();
+    Serial.feed(seqFrame(1, MSG_CLEAR));
+    comms.poll();
+    host::runTasks();
+    std::vector<Frame> frames = deviceFrames();
+    CHECK(frames.size() == 1 && frames[0].type == MSG_ACK && frames[0].payload[0] == 1);
+    CHECK(comms.linkStats().acksSent == 1);
+}
+
+static std::vector<std::string> s_texts;
+static void onText(const msg::DisplayText& m) { s_texts.emplace_back(m.text, m.len); }
+
+// One host→device frame in a hundred is lost and one gets a bit flipped;
+// one poll in sixteen loses what the device wrote back and one garbles it.
+// The host reads the device and sends more every millisecond.
+static void testLossyLink() {
+    SerialComms comms;
+    comms.on(onText);
+    startReliable(comms);
+    ReliableHost sender(20000);
+    std::mt19937 rng(11);
+
+    const int MESSAGES = 3000;
+    int queued = 0;
+    s_texts.clear();
+    for (int round = 0; !sender.idle() || queued < MESSAGES; round++) {
+        CHECK(round < 200000);
+        while (queued < MESSAGES && sender.queued() < 100) {
+            std::string text = "notification " + std::to_string(queued++);
+            sender.send(MSG_DISPLAY_TEXT, (const uint8_t*)text.data(), text.size());
+        }
+        sender.pump(host::nowUs(), [&](const uint8_t* p, size_t n) {
+            std::vector<uint8_t> f(p, p + n);
+            uint32_t r = rng() % 100;
+            if (r == 0) return;
+            if (r == 1) f[rng() % n] ^= 1 << rng() % 8;
+            Serial.feed(f);
+        });
+        comms.poll();
+        host::runTasks();
+
+        std::vector<uint8_t> out;
+        out.swap(Serial.tx);
+        uint32_t r = rng() % 16;
+        if (r == 0) out.clear();
+        if (r == 1 && !out.empty()) out[rng() % out.size()] ^= 1 << rng() % 8;
+        sender.receive(out.data(), out.size(), host::nowUs());
+        host::advanceUs(1000);
+    }
+
+    CHECK(s_texts.size() == MESSAGES);
+    for (int i = 0; i < MESSAGES; i++) CHECK(s_texts[i] == "notification " + std::to_string(i));
+    const ReliableHost::Stats& hs = sender.stats();
+    const SerialComms::LinkStats& ds = comms.linkStats();
+    CHECK(hs.retransmits > 0 && hs.goBacks > 0 && hs.timeouts > 0 && hs.badFrames > 0);
+    CHECK(hs.sent == MESSAGES + hs.retransmits);
+    CHECK(ds.rxBadFrames > 0 && ds.rxGaps > 0 && ds.rxDuplicates > 0);
+    printf("test_reliable: %d messages in %u frames, %u resent (%u go-backs, %u timeouts); "
+           "device saw %u gaps, %u duplicates, %u bad frames\n",
+           MESSAGES, hs.sent, hs.retransmits, hs.goBacks, hs.timeouts, ds.rxGaps, ds.rxDuplicates,
+           ds.rxBadFrames);
+}
+
+int main() {
+    testAckWithFullBulkLane();
+    testAckSuperseded();
+    testLossyLink();
+    puts("test_reliable ok");
+    return 0;
+}
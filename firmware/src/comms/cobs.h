@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Consistent Overhead Byte Stuffing.
+//
+// Encoded data never contains 0x00, so 0x00 is an unambiguous frame
+// delimiter: after any corruption the receiver is back in sync at the next
+// zero byte. Each block is a code byte N (1..255) followed by N-1 non-zero
+// data bytes; a block shorter than 255 implies a zero after it, except at
+// the end of the frame. Overhead is at most one byte per 254.
+
+namespace cobs {
+
+constexpr size_t maxEncodedLen(size_t len) {
+    return len + len / 254 + 1;
+}
+
+// Streaming encoder: feed the frame in any number of put() calls, straight
+// into the output buffer, then finish(). The delimiter is not written.
+class Encoder {
+public:
+    explicit Encoder(uint8_t* out) : _out(out), _codeIdx(0), _pos(1), _run(1) {}
+
+    void put(const uint8_t* data, size_t len) {
+        for (size_t i = 0; i < len; i++) {
+            uint8_t b = data[i];
+            if (b == 0) {
+                closeBlock();
+                continue;
+            }
+            _out[_pos++] = b;
+            if (++_run == 0xFF) {
+                closeBlock();
+            }
+        }
+    }
+
+    void put(uint8_t b) { put(&b, 1); }
+
+    // Returns the encoded length.
+    size_t finish() {
+        _out[_codeIdx] = _run;
+        return _pos;
+    }
+
+private:
+    void closeBlock() {
+        _out[_codeIdx] = _run;
+        _codeIdx = _pos++;
+        _run = 1;
+    }
+
+    uint8_t* _out;
+    size_t   _codeIdx;  // Where the current block's code byte goes
+    size_t   _pos;      // Next output byte
+    uint8_t  _run;      // Code for the current block so far
+};
+
+// Decode one frame (delimiter excluded). out may equal in: the write
+// position never passes the read position, so the frame can be decoded in
+// place inside the RX buffer. Returns false on a malformed frame.
+inline bool decode(const uint8_t* in, size_t len, uint8_t* out, size_t* outLen) {
+    size_t r = 0;
+    size_t w = 0;
+    while (r < len) {
+        uint8_t code = in[r++];
+        if (code == 0 || (size_t)(code - 1) > len - r) return false;
+        memmove(out + w, in + r, code - 1);
+        w += code - 1;
+        r += code - 1;
+        if (code != 0xFF && r < len) {
+            out[w++] = 0;
+        }
+    }
+    *outLen = w;
+    return true;
+}
+
+} // namespace cobs
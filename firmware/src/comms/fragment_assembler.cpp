@@ -0,0 +1,69 @@
+#include "fragment_assembler.h"
+#include "protocol.h"
+#include <cstring>
+#include <esp_heap_caps.h>
+
+bool FragmentAssembler::begin() {
+    if (!_buf) {
+        _buf = (uint8_t*)heap_caps_malloc(MAX_REASSEMBLED_LEN, MALLOC_CAP_SPIRAM);
+    }
+    _active = false;
+    return _buf != nullptr;
+}
+
+bool FragmentAssembler::feed(const uint8_t* payload, uint16_t len) {
+    if (!_buf || len < HEADER_LEN) return false;
+
+    uint8_t  msgId     = payload[0];
+    uint8_t  index     = payload[1];
+    uint8_t  innerType = payload[2];
+    uint8_t  codec     = payload[3];
+    uint16_t total     = ((uint16_t)payload[4] << 8) | payload[5];
+    const uint8_t* data = payload + HEADER_LEN;
+    uint16_t dataLen    = len - HEADER_LEN;
+
+    if (index == 0) {
+        if (total == 0 || total > MAX_REASSEMBLED_LEN || innerType == MSG_FRAGMENT ||
+            (codec != protocol::CODEC_RAW && codec != protocol::CODEC_LZ4)) {
+            _active = false;
+            return false;
+        }
+        _active = true;
+        _msgId = msgId;
+        _nextIndex = 0;
+        _innerType = innerType;
+        _codec = codec;
+        _total = total;
+        _rawLen = 0;
+        if (codec == protocol::CODEC_LZ4) {
+            _lz4.begin(_buf, total);
+        }
+    }
+
+    if (!_active || msgId != _msgId || index != _nextIndex ||
+        innerType != _innerType || codec != _codec || total != _total) {
+        _active = false;
+        return false;
+    }
+    _nextIndex++;
+
+    bool complete;
+    if (_codec == protocol::CODEC_LZ4) {
+        if (!_lz4.feed(data, dataLen)) {
+            _active = false;
+            return false;
+        }
+        complete = _lz4.produced() == _total && _lz4.atBoundary();
+    } else {
+        if (dataLen > _total - _rawLen) {
+            _active = false;
+            return false;
+        }
+        memcpy(_buf + _rawLen, data, dataLen);
+        _rawLen += dataLen;
+        complete = _rawLen == _total;
+    }
+
+    if (complete) _active = false;
+    return complete;
+}
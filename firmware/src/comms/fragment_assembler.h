@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include "lz4_stream.h"
+
+// Reassembles MSG_FRAGMENT sequences into one message of up to
+// MAX_REASSEMBLED_LEN bytes, held in PSRAM.
+//
+// Fragment payload:
+//   [MSG_ID] [FRAG_INDEX] [INNER_TYPE] [CODEC] [TOTAL_HI] [TOTAL_LO] [DATA...]
+//
+// TOTAL is the length of the complete inner payload after decompression.
+// Fragments of one message share MSG_ID and arrive in order starting at
+// index 0; INNER_TYPE, CODEC and TOTAL are repeated in each so any
+// fragment can be checked on its own. Index 0 always starts a new message
+// and abandons an unfinished one; a gap or a mismatched header drops the
+// message. With CODEC_LZ4 the concatenated DATA is one LZ4 block,
+// decompressed incrementally as each fragment arrives.
+class FragmentAssembler {
+public:
+    static const uint16_t HEADER_LEN = 6;
+
+    bool begin();
+
+    // Feed one MSG_FRAGMENT payload. Returns true when it completes a
+    // message, which is then described by msgType()/data()/length() until
+    // the next call.
+    bool feed(const uint8_t* payload, uint16_t len);
+    void reset() { _active = false; }
+
+    uint8_t        msgType() const { return _innerType; }
+    const uint8_t* data() const    { return _buf; }
+    uint16_t       length() const  { return _total; }
+
+private:
+    uint8_t* _buf = nullptr;
+    bool     _active = false;
+    uint8_t  _msgId = 0;
+    uint8_t  _nextIndex = 0;
+    uint8_t  _innerType = 0;
+    uint8_t  _codec = 0;
+    uint16_t _total = 0;
+    uint16_t _rawLen = 0;  // Bytes received so far for CODEC_RAW
+    Lz4StreamDecoder _lz4;
+};
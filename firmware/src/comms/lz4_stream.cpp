@@ -0,0 +1,97 @@
+#include "lz4_stream.h"
+#include <cstring>
+
+static const uint8_t  LZ4_RUN_MASK = 0x0F;  // Nibble value meaning "more length bytes follow"
+static const size_t   LZ4_MIN_MATCH = 4;
+
+void Lz4StreamDecoder::begin(uint8_t* out, size_t capacity) {
+    _out = out;
+    _capacity = capacity;
+    _outPos = 0;
+    _state = TOKEN;
+    _token = 0;
+    _remaining = 0;
+    _offset = 0;
+}
+
+bool Lz4StreamDecoder::atBoundary() const {
+    // A block ends with a literal-only sequence, after which the decoder
+    // waits for an offset that never comes
+    return _state == TOKEN || (_state == OFFSET_LO && _remaining == 0);
+}
+
+bool Lz4StreamDecoder::feed(const uint8_t* in, size_t len) {
+    size_t pos = 0;
+    while (pos < len) {
+        switch (_state) {
+        case TOKEN:
+            _token = in[pos++];
+            _remaining = _token >> 4;
+            _state = _remaining == LZ4_RUN_MASK ? LITERAL_LEN
+                   : _remaining > 0            ? LITERALS
+                                               : OFFSET_LO;
+            break;
+
+        case LITERAL_LEN: {
+            uint8_t b = in[pos++];
+            _remaining += b;
+            if (b != 255) _state = _remaining > 0 ? LITERALS : OFFSET_LO;
+            break;
+        }
+
+        case LITERALS: {
+            size_t n = len - pos < _remaining ? len - pos : _remaining;
+            if (n > _capacity - _outPos) return false;
+            memcpy(_out + _outPos, in + pos, n);
+            _outPos += n;
+            pos += n;
+            _remaining -= n;
+            if (_remaining == 0) _state = OFFSET_LO;
+            break;
+        }
+
+        case OFFSET_LO:
+            _offset = in[pos++];
+            _state = OFFSET_HI;
+            break;
+
+        case OFFSET_HI:
+            _offset |= (uint16_t)in[pos++] << 8;
+            if (_offset == 0 || _offset > _outPos) return false;
+            _remaining = _token & LZ4_RUN_MASK;
+            if (_remaining == LZ4_RUN_MASK) {
+                _state = MATCH_LEN;
+            } else if (!copyMatch()) {
+                return false;
+            }
+            break;
+
+        case MATCH_LEN: {
+            uint8_t b = in[pos++];
+            _remaining += b;
+            if (b != 255 && !copyMatch()) return false;
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+// Copy _remaining + 4 bytes from _offset back. Overlapping matches (offset
+// shorter than the length) repeat the pattern, so those go byte by byte.
+bool Lz4StreamDecoder::copyMatch() {
+    size_t n = _remaining + LZ4_MIN_MATCH;
+    if (n > _capacity - _outPos) return false;
+
+    uint8_t* dst = _out + _outPos;
+    const uint8_t* src = dst - _offset;
+    if (_offset >= n) {
+        memcpy(dst, src, n);
+    } else {
+        for (size_t i = 0; i < n; i++) dst[i] = src[i];
+    }
+    _outPos += n;
+    _remaining = 0;
+    _state = TOKEN;
+    return true;
+}
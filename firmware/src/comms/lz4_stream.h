@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Incremental decoder for the LZ4 block format (as produced by
+// LZ4_compress_default / lz4.block.compress(store_size=False)).
+//
+// Compressed input can be fed in arbitrary pieces — one per fragment — and
+// is decoded straight into the caller's output buffer, which also serves
+// as the match history. Apart from that buffer the decoder keeps a few
+// bytes of state, so working memory is bounded by the output size.
+class Lz4StreamDecoder {
+public:
+    void begin(uint8_t* out, size_t capacity);
+
+    // Decode the next piece of compressed input. Returns false if the data
+    // is corrupt (match offset before the start, output overflow); the
+    // decoder must be restarted with begin() after that.
+    bool feed(const uint8_t* in, size_t len);
+
+    size_t produced() const { return _outPos; }
+
+    // True when the output so far ends on a sequence boundary — with the
+    // expected length reached, the block is complete.
+    bool atBoundary() const;
+
+private:
+    enum State : uint8_t {
+        TOKEN,
+        LITERAL_LEN,
+        LITERALS,
+        OFFSET_LO,
+        OFFSET_HI,
+        MATCH_LEN
+    };
+
+    bool copyMatch();
+
+    uint8_t* _out = nullptr;
+    size_t   _capacity = 0;
+    size_t   _outPos = 0;
+    State    _state = TOKEN;
+    uint8_t  _token = 0;
+    size_t   _remaining = 0;  // Literal bytes left, or match length being accumulated
+    uint16_t _offset = 0;
+};
@@ -0,0 +1,360 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include "../config.h"
+#include "protocol.h"
+#include "fragment_assembler.h"
+
+// Host→device messages as typed views over the payload bytes.
+//
+// Each message derives from Message<ID, MIN_LEN, MAX_LEN> and provides
+//   static bool parse(const uint8_t* payload, uint16_t len, View& out)
+// which fills the view in place (pointers into the payload, no copies) and
+// returns false if the payload breaks a rule the length bounds can't
+// express. Views are only valid for the duration of the handler call.
+//
+// To add a message: declare its view here, add it to the dispatch list in
+// serial_comms.cpp and either give SerialComms a handle() overload for it
+// or list it in AppMessages so the application can register a handler.
+namespace msg {
+
+template <uint8_t Id, uint16_t MinLen = 0, uint16_t MaxLen = MAX_REASSEMBLED_LEN>
+struct Message {
+    static constexpr uint8_t  ID = Id;
+    static constexpr uint16_t MIN_LEN = MinLen;
+    static constexpr uint16_t MAX_LEN = MaxLen;
+    static_assert(MinLen <= MaxLen, "message length bounds are inverted");
+    static_assert(MaxLen <= MAX_REASSEMBLED_LEN, "message can never arrive that long");
+};
+
+inline uint16_t getBe16(const uint8_t* p) {
+    return ((uint16_t)p[0] << 8) | p[1];
+}
+
+// --- Handled by the application ---
+
+struct DisplayText : Message<MSG_DISPLAY_TEXT, 1> {
+    const char* text;
+    uint16_t    len;
+
+    static bool parse(const uint8_t* p, uint16_t n, DisplayText& m) {
+        m.text = (const char*)p;
+        m.len = n;
+        return true;
+    }
+};
+
+struct StatusText : Message<MSG_STATUS, 1> {
+    const char* text;
+    uint16_t    len;
+
+    static bool parse(const uint8_t* p, uint16_t n, StatusText& m) {
+        m.text = (const char*)p;
+        m.len = n;
+        return true;
+    }
+};
+
+// [pixel, r, g, b] repeated; a trailing partial entry is ignored
+struct SetLeds : Message<MSG_SET_LEDS, 4> {
+    static constexpr uint16_t ENTRY_LEN = 4;
+    const uint8_t* entries;
+    uint16_t       count;
+
+    uint8_t  pixel(uint16_t i) const { return entries[i * ENTRY_LEN]; }
+    uint32_t color(uint16_t i) const {
+        const uint8_t* e = entries + i * ENTRY_LEN;
+        return ((uint32_t)e[1] << 16) | ((uint32_t)e[2] << 8) | e[3];
+    }
+
+    static bool parse(const uint8_t* p, uint16_t n, SetLeds& m) {
+        m.entries = p;
+        m.count = n / ENTRY_LEN;
+        return true;
+    }
+};
+
+struct Clear : Message<MSG_CLEAR> {
+    static bool parse(const uint8_t*, uint16_t, Clear&) { return true; }
+};
+
+// [len, bytes...] for up to four labels. Parsing stops at a label that
+// runs past the payload; the ones before it still apply and the rest are
+// empty. Labels are not NUL-terminated.
+struct SetLabels : Message<MSG_SET_LABELS, 1> {
+    struct Label {
+        const char* text;
+        uint8_t     len;
+
+        // NUL-terminated copy of at most size - 1 bytes. A label that
+        // doesn't fit is cut on a character boundary, not inside a UTF-8
+        // sequence. Returns the length copied.
+        uint8_t copyTo(char* out, uint8_t size) const {
+            uint8_t n = len;
+            if (n > size - 1) {
+                n = size - 1;
+                while (n > 0 && ((uint8_t)text[n] & 0xC0) == 0x80) n--;
+            }
+            memcpy(out, text, n);
+            out[n] = '\0';
+            return n;
+        }
+    };
+    Label labels[4];
+
+    static bool parse(const uint8_t* p, uint16_t n, SetLabels& m) {
+        uint16_t pos = 0;
+        for (Label& label : m.labels) {
+            label = {"", 0};
+            if (pos >= n) continue;
+            uint8_t len = p[pos];
+            if (len > n - pos - 1) {
+                pos = n;
+                continue;
+            }
+            label = {(const char*)p + pos + 1, len};
+            pos += 1 + len;
+        }
+        return true;
+    }
+};
+
+// See protocol::TEXT_OP_*. offset and count are only set by the ops that
+// carry them. Whether a well-formed patch applies is up to the handler,
+// which answers with SerialComms::sendTextRevision() if it doesn't.
+struct TextPatch : Message<MSG_TEXT_PATCH, 3> {
+    uint8_t     op;
+    uint16_t    baseRev;
+    uint16_t    offset;
+    uint16_t    count;
+    const char* data;
+    uint16_t    len;
+
+    static bool parse(const uint8_t* p, uint16_t n, TextPatch& m) {
+        m.op = p[0];
+        m.baseRev = getBe16(p + 1);
+        m.offset = 0;
+        m.count = 0;
+        uint16_t argsLen;
+        switch (m.op) {
+        case protocol::TEXT_OP_APPEND:   argsLen = 0; break;
+        case protocol::TEXT_OP_REPLACE:  argsLen = 4; break;
+        case protocol::TEXT_OP_TRUNCATE: argsLen = 2; break;
+        default:                         return false;
+        }
+        if (n < MIN_LEN + argsLen) return false;
+
+        const uint8_t* args = p + MIN_LEN;
+        if (argsLen >= 2) m.offset = getBe16(args);
+        if (argsLen >= 4) m.count = getBe16(args + 2);
+        m.data = (const char*)args + argsLen;
+        m.len = n - MIN_LEN - argsLen;
+        return m.op != protocol::TEXT_OP_TRUNCATE || m.len == 0;
+    }
+};
+
+// See protocol::TEXT_PAGE_*
+struct TextPage : Message<MSG_TEXT_PAGE, 1, 3> {
+    uint8_t  op;
+    uint16_t page;
+
+    static bool parse(const uint8_t* p, uint16_t n, TextPage& m) {
+        m.op = p[0];
+        m.page = 0;
+        if (m.op == protocol::TEXT_PAGE_GOTO) {
+            if (n < 3) return false;
+            m.page = getBe16(p + 1);
+            return true;
+        }
+        return m.op == protocol::TEXT_PAGE_NEXT || m.op == protocol::TEXT_PAGE_PREV;
+    }
+};
+
+// See protocol::IMAGE_*. The image must fit on screen.
+struct Image : Message<MSG_IMAGE, protocol::IMAGE_HEADER_LEN> {
+    uint16_t       x;
+    uint16_t       y;
+    uint16_t       w;
+    uint16_t       h;
+    uint16_t       row;
+    uint8_t        encoding;
+    const uint8_t* data;
+    uint16_t       len;
+
+    static bool parse(const uint8_t* p, uint16_t n, Image& m) {
+        m.x = getBe16(p);
+        m.y = getBe16(p + 2);
+        m.w = getBe16(p + 4);
+        m.h = getBe16(p + 6);
+        m.row = getBe16(p + 8);
+        m.encoding = p[10];
+        m.data = p + MIN_LEN;
+        m.len = n - MIN_LEN;
+        if (m.w == 0) return true;
+        return m.encoding <= protocol::IMAGE_QOI && m.h > 0 && m.row < m.h &&
+               m.x + m.w <= SCREEN_WIDTH && m.y + m.h <= SCREEN_HEIGHT;
+    }
+};
+
+// See protocol::ASSET_*
+struct AssetShow : Message<MSG_ASSET_SHOW, protocol::ASSET_HASH_LEN + 4,
+                           protocol::ASSET_HASH_LEN + 4> {
+    const uint8_t* hash;
+    uint16_t       x;
+    uint16_t       y;
+
+    static bool parse(const uint8_t* p, uint16_t, AssetShow& m) {
+        m.hash = p;
+        m.x = getBe16(p + protocol::ASSET_HASH_LEN);
+        m.y = getBe16(p + protocol::ASSET_HASH_LEN + 2);
+        return true;
+    }
+};
+
+// The image fields are also handed over as the body they were hashed in
+struct AssetPut : Message<MSG_ASSET_PUT, protocol::ASSET_HEADER_LEN + 1> {
+    const uint8_t* hash;
+    const uint8_t* body;
+    uint16_t       bodyLen;
+    uint16_t       w;
+    uint16_t       h;
+    uint8_t        encoding;
+    const uint8_t* data;
+    uint16_t       len;
+
+    static bool parse(const uint8_t* p, uint16_t n, AssetPut& m) {
+        m.hash = p;
+        m.body = p + protocol::ASSET_HASH_LEN;
+        m.bodyLen = n - protocol::ASSET_HASH_LEN;
+        m.w = getBe16(m.body);
+        m.h = getBe16(m.body + 2);
+        m.encoding = m.body[4];
+        m.data = p + protocol::ASSET_HEADER_LEN;
+        m.len = n - protocol::ASSET_HEADER_LEN;
+        return m.encoding <= protocol::IMAGE_QOI && m.w > 0 && m.h > 0 &&
+               m.w <= SCREEN_WIDTH && m.h <= SCREEN_HEIGHT;
+    }
+};
+
+// --- Handled by SerialComms itself ---
+
+struct Ping : Message<MSG_PING> {
+    const uint8_t* data;
+    uint16_t       len;
+
+    static bool parse(const uint8_t* p, uint16_t n, Ping& m) {
+        m.data = p;
+        m.len = n;
+        return true;
+    }
+};
+
+// [max_version, features]; an empty HELLO is a v1 host without features
+struct Hello : Message<MSG_HELLO> {
+    uint8_t maxVersion;
+    uint8_t features;
+
+    static bool parse(const uint8_t* p, uint16_t n, Hello& m) {
+        m.maxVersion = n > 0 ? p[0] : protocol::VERSION_1;
+        m.features = n > 1 ? p[1] : 0;
+        return true;
+    }
+};
+
+struct Batch : Message<MSG_BATCH> {
+    const uint8_t* data;
+    uint16_t       len;
+
+    static bool parse(const uint8_t* p, uint16_t n, Batch& m) {
+        m.data = p;
+        m.len = n;
+        return true;
+    }
+};
+
+struct Fragment : Message<MSG_FRAGMENT, FragmentAssembler::HEADER_LEN, MAX_MSG_LEN> {
+    const uint8_t* data;
+    uint16_t       len;
+
+    static bool parse(const uint8_t* p, uint16_t n, Fragment& m) {
+        m.data = p;
+        m.len = n;
+        return true;
+    }
+};
+
+// [stats_id, args...]; what args mean, if anything, depends on the id
+struct GetStats : Message<MSG_GET_STATS, 1> {
+    uint8_t        id;
+    const uint8_t* args;
+    uint16_t       argsLen;
+
+    static bool parse(const uint8_t* p, uint16_t n, GetStats& m) {
+        m.id = p[0];
+        m.args = p + 1;
+        m.argsLen = n - 1;
+        return true;
+    }
+};
+
+// [t1(8)], echoed untouched
+struct TimeSync : Message<MSG_TIME_SYNC, 8> {
+    const uint8_t* t1;
+
+    static bool parse(const uint8_t* p, uint16_t, TimeSync& m) {
+        m.t1 = p;
+        return true;
+    }
+};
+
+// --- Dispatch table ---
+
+template <class... Ms>
+constexpr bool uniqueIds() {
+    const uint8_t ids[] = {Ms::ID...};
+    for (size_t i = 0; i < sizeof...(Ms); i++) {
+        for (size_t j = i + 1; j < sizeof...(Ms); j++) {
+            if (ids[i] == ids[j]) return false;
+        }
+    }
+    return true;
+}
+
+// One entry per message type byte, built at compile time. Owner provides
+// a static dispatch<M>(Owner&, payload, len) for each listed message.
+template <class Owner, class... Ms>
+struct DispatchTable {
+    static_assert(uniqueIds<Ms...>(), "two messages share an ID");
+
+    using Thunk = void (*)(Owner&, const uint8_t*, uint16_t);
+    Thunk entries[256];
+
+    constexpr DispatchTable() : entries{} {
+        ((entries[Ms::ID] = &Owner::template dispatch<Ms>), ...);
+    }
+
+    Thunk operator[](uint8_t id) const { return entries[id]; }
+};
+
+template <class M>
+using Handler = void (*)(const M&);
+
+template <class... Ms>
+struct List {};
+
+// Messages whose handler the application registers with SerialComms::on()
+using AppMessages = List<DisplayText, StatusText, SetLeds, Clear, SetLabels, TextPatch,
+                         TextPage, Image, AssetShow, AssetPut>;
+
+template <class L>
+struct HandlerTuple;
+
+template <class... Ms>
+struct HandlerTuple<List<Ms...>> {
+    using type = std::tuple<Handler<Ms>...>;
+};
+
+} // namespace msg
@@ -1,17 +1,151 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include "../config.h"
+#include "cobs.h"
 
-// Frame format:
+// Frame format (v1):
 //   [START_BYTE(0xAA)] [LEN_HI] [LEN_LO] [MSG_TYPE] [PAYLOAD...] [CHECKSUM]
 //
 // LEN = number of bytes in MSG_TYPE + PAYLOAD (excludes start, length, checksum)
 // CHECKSUM = XOR of all bytes from MSG_TYPE through end of PAYLOAD
+//
+// Frame format (v2):
+//   [START_BYTE(0xAB)] [LEN_HI] [LEN_LO] [MSG_TYPE] [PAYLOAD...] [CRC0..CRC3]
+//
+// Same header and LEN as v1; the trailer is the CRC-32 (IEEE 802.3, as used
+// by zlib/Ethernet) of MSG_TYPE through end of PAYLOAD, little-endian.
+//
+// COBS framing (optional, v2 only):
+//   COBS([MSG_TYPE] [PAYLOAD...] [CRC0..CRC3]) [0x00]
+//
+// The body and CRC-32 are the same as v2 but the frame is COBS-encoded and
+// terminated by 0x00, which never occurs inside an encoded frame. A
+// receiver that loses sync drops at most the frame in progress and is
+// back in step at the next delimiter, with no timeout involved.
+//
+// The device accepts v1 and v2 frames until a MSG_HELLO selects v2; from
+// then on a v1 frame is dropped unless it is a MSG_HELLO, so a host that
+// starts over can still renegotiate. It transmits v1 until the host
+// sends MSG_HELLO [max_version, features]; the reply MSG_HELLO
+// [supported_mask, selected_version, enabled_features] goes out as v1 and
+// everything after it uses the selected version. If FEATURE_COBS was
+// requested and granted, both directions switch to COBS framing right
+// after the reply. A COBS-mode host can send another MSG_HELLO without the
+// flag to return to 0xAA/0xAB framing; the device also reverts when the
+// bridge times out. Firmware without MSG_HELLO ignores it, so a host that
+// gets no reply simply stays on v1.
+//
+// Reliable delivery (FEATURE_RELIABLE): once granted, every host→device
+// frame body is [SEQ] [MSG_TYPE] [PAYLOAD...] in whichever framing is in
+// use, with SEQ counting up from 0 (mod 256). The device processes frames
+// strictly in order and answers with MSG_ACK [ack_seq, credit_hi,
+// credit_lo]: ack_seq is the last in-order SEQ it accepted (cumulative),
+// credit the number of bytes it can buffer right now. The host may keep
+// up to credit bytes in flight. A frame after a gap is dropped and
+// answered with a duplicate ACK so the host can go back and resend from
+// ack_seq + 1; a frame the device already has is re-acknowledged but not
+// processed twice. ACKs are coalesced to one per burst of received frames.
+// Only the host→device direction is covered: device→host frames carry no
+// SEQ, and resending is up to the host. host/reliable_host.h is a
+// go-back-N reference sender, run over a lossy link in
+// host/test_reliable.cpp; the bridge in src/serial doesn't negotiate the
+// feature yet.
+//
+// Button timestamps (FEATURE_BUTTON_TIME): button events go out as
+// MSG_BUTTON_EX instead of MSG_BUTTON. edge_us is the device clock
+// (microseconds since boot) at the first raw sample that showed the change,
+// latency_us the time from there until the event was queued (debounce plus
+// poll scheduling). MSG_TIME_SYNC maps the device clock to the host's, NTP
+// style: the host sends its clock t1, the device answers with t1, t2 (when
+// the request was read from the driver) and t3 (when the reply was
+// queued). With t4 the host's receive time, the device clock is ahead of
+// the host's by ((t2 - t1) + (t3 - t4)) / 2, give or take half of
+// (t4 - t1) - (t3 - t2). MSG_TIME_SYNC works without the feature flag.
 
 namespace protocol {
 
+static constexpr uint8_t  VERSION_1 = 1;
+static constexpr uint8_t  VERSION_2 = 2;
+static constexpr uint8_t  SUPPORTED_VERSIONS = (1u << (VERSION_1 - 1)) | (1u << (VERSION_2 - 1));
+
+// MSG_HELLO feature flags
+static constexpr uint8_t  FEATURE_COBS = 0x01;
+static constexpr uint8_t  FEATURE_RELIABLE = 0x02;
+static constexpr uint8_t  FEATURE_BUTTON_TIME = 0x04;
+static constexpr uint8_t  SUPPORTED_FEATURES = FEATURE_COBS | FEATURE_RELIABLE | FEATURE_BUTTON_TIME;
+
+// MSG_GET_STATS / MSG_STATS ids
+static constexpr uint8_t  STATS_LINK = 0;
+static constexpr uint8_t  STATS_TEXT_LATENCY = 1;    // Text frame verified → its LVGL flush done
+static constexpr uint8_t  STATS_BUTTON_LATENCY = 2;  // Raw button edge → Serial.write returned
+static constexpr uint8_t  STATS_FRAME_TIME = 3;      // LVGL refresh that drew something
+static constexpr uint8_t  STATS_FRAME_PACING = 4;    // [vsyncs, refreshes, missed, tears, skipped_waits] u32 LE
+static constexpr uint8_t  STATS_GLYPH_CACHE = 5;     // [hits, misses, evictions, entries, bytes] u32 LE
+static constexpr uint8_t  STATS_FRAME_PROFILE = 6;   // Per-frame records, see util/stats_codec.h
+static constexpr uint8_t  STATS_UI_QUEUE = 7;        // [enqueued, coalesced, full_waits, high_water, depth] u32 LE
+static constexpr uint8_t  STATS_ASSETS = 8;          // AssetStore::Stats, u32 LE in declaration order
+static constexpr uint16_t MAX_STATS_LEN = MAX_MSG_LEN - 1;  // MSG_STATS payload in one frame
+
+// MSG_TEXT_PATCH operations on the resident notification text:
+//   APPEND   [data...]
+//   REPLACE  [offset_hi, offset_lo, remove_hi, remove_lo, data...]
+//   TRUNCATE [len_hi, len_lo]
+// MSG_DISPLAY_TEXT sets revision 0 and every applied patch adds one. A
+// patch whose base revision isn't the current one, or that doesn't fit,
+// is dropped and answered with MSG_TEXT_REV so the host can resend the
+// full text.
+static constexpr uint8_t  TEXT_OP_APPEND = 0;
+static constexpr uint8_t  TEXT_OP_REPLACE = 1;
+static constexpr uint8_t  TEXT_OP_TRUNCATE = 2;
+
+// MSG_TEXT_PAGE operations on the notification pager; the page number is
+// only sent with GOTO. Pages past the end show the last one. The device
+// answers every page command, and every page turned by a local pager
+// button, with MSG_TEXT_PAGE [page, pages] (big-endian); a GOTO to the
+// current page is a query.
+static constexpr uint8_t  TEXT_PAGE_GOTO = 0;
+static constexpr uint8_t  TEXT_PAGE_NEXT = 1;
+static constexpr uint8_t  TEXT_PAGE_PREV = 2;
+
+// MSG_IMAGE: rows from `row` on of a w x h RGB565 image placed at (x, y),
+// all big-endian. Row 0 starts a new image, replacing the one shown; later
+// messages continue it, each decodable on its own, so an image too big for
+// one message arrives in bands of rows. w = 0 removes the image.
+static constexpr uint8_t  IMAGE_RAW = 0;  // RGB565 little-endian, whole rows
+static constexpr uint8_t  IMAGE_QOI = 1;  // A complete QOI image w x (rows sent); alpha ignored
+static constexpr uint16_t IMAGE_HEADER_LEN = 11;
+
+// Content-addressed images kept in flash. MSG_ASSET_SHOW names one by
+// hash and the device shows it like a whole MSG_IMAGE at (x, y), or
+// answers MSG_ASSET_MISS; the host then sends the bytes in MSG_ASSET_PUT
+// (fragmented as needed) and the show again, so an icon crosses the link
+// once. The hash is the first ASSET_HASH_LEN bytes of the SHA-256 of the
+// PUT payload after the hash: [w(2), h(2), encoding, data], which is
+// what the device stores and checks.
+static constexpr uint8_t  ASSET_HASH_LEN = 16;
+static constexpr uint16_t ASSET_HEADER_LEN = ASSET_HASH_LEN + 5;
+
+// MSG_FRAGMENT payload codecs
+static constexpr uint8_t  CODEC_RAW = 0;
+static constexpr uint8_t  CODEC_LZ4 = 1;  // LZ4 block format
+
+// Bytes a frame adds around MSG_TYPE + PAYLOAD
+static constexpr uint16_t FRAME_OVERHEAD_V1 = 4;   // start + len(2) + xor
+static constexpr uint16_t FRAME_OVERHEAD_V2 = 7;   // start + len(2) + crc32
+static constexpr uint16_t COBS_DELIMITER = 0x00;
+static constexpr uint16_t MAX_COBS_BODY_LEN = MAX_MSG_LEN + 4;  // body + crc32
+static constexpr uint16_t MAX_COBS_FRAME_LEN = cobs::maxEncodedLen(MAX_COBS_BODY_LEN) + 1;
+static constexpr uint16_t MAX_FRAME_LEN =
+    MAX_COBS_FRAME_LEN > MAX_MSG_LEN + FRAME_OVERHEAD_V2 ? MAX_COBS_FRAME_LEN
+                                                         : MAX_MSG_LEN + FRAME_OVERHEAD_V2;
+
+inline uint16_t frameOverhead(uint8_t version) {
+    return version == VERSION_2 ? FRAME_OVERHEAD_V2 : FRAME_OVERHEAD_V1;
+}
+
 inline uint8_t checksum(const uint8_t* data, uint16_t len) {
     uint8_t cs = 0;
     for (uint16_t i = 0; i < len; i++) {
@@ -20,20 +154,132 @@ inline uint8_t checksum(const uint8_t* data, uint16_t len) {
     return cs;
 }
 
+// --- CRC-32, slicing-by-4 ---
+// Four 256-entry tables (4 KB, built at compile time) let the inner loop
+// fold a 32-bit word per iteration instead of a byte.
+struct Crc32Tables {
+    uint32_t t[4][256];
+
+    constexpr Crc32Tables() : t{} {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (c >> 1) ^ 0xEDB88320u : (c >> 1);
+            }
+            t[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int s = 1; s < 4; s++) {
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+inline constexpr Crc32Tables kCrc32Tables{};
+
+// Continue a CRC-32 over more data; start with crc = 0. Chaining calls over
+// consecutive spans gives the same result as one call over the whole range.
+inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+    const auto& t = kCrc32Tables.t;
+    crc = ~crc;
+
+    // Byte-wise until the pointer is word-aligned (Xtensa has no unaligned loads)
+    while (len > 0 && ((uintptr_t)data & 3) != 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+        len--;
+    }
+    while (len >= 4) {
+        uint32_t word;
+        memcpy(&word, data, 4);  // aligned, so this is a single l32i
+        crc ^= word;             // little-endian target
+        crc = t[3][crc & 0xFF] ^ t[2][(crc >> 8) & 0xFF] ^
+              t[1][(crc >> 16) & 0xFF] ^ t[0][crc >> 24];
+        data += 4;
+        len -= 4;
+    }
+    while (len > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+        len--;
+    }
+    return ~crc;
+}
+
+inline uint32_t crc32(const uint8_t* data, size_t len) {
+    return crc32Update(0, data, len);
+}
+
+inline void putLe32(uint8_t* p, uint32_t v) {
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+inline uint32_t getLe32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void putLe64(uint8_t* p, uint64_t v) {
+    putLe32(p, (uint32_t)v);
+    putLe32(p + 4, (uint32_t)(v >> 32));
+}
+
+inline uint64_t getLe64(const uint8_t* p) {
+    return (uint64_t)getLe32(p) | ((uint64_t)getLe32(p + 4) << 32);
+}
+
 // Build a frame into buf. Returns total frame length.
-// buf must be at least payloadLen + 5 bytes.
+// buf must be at least payloadLen + 1 + frameOverhead(version) bytes.
 inline uint16_t buildFrame(uint8_t* buf, uint8_t msgType,
-                           const uint8_t* payload, uint16_t payloadLen) {
+                           const uint8_t* payload, uint16_t payloadLen,
+                           uint8_t version = VERSION_1) {
     uint16_t bodyLen = 1 + payloadLen;  // msgType + payload
-    buf[0] = FRAME_START_BYTE;
+    buf[0] = version == VERSION_2 ? FRAME_START_BYTE_V2 : FRAME_START_BYTE;
     buf[1] = (bodyLen >> 8) & 0xFF;
     buf[2] = bodyLen & 0xFF;
     buf[3] = msgType;
     if (payload && payloadLen > 0) {
         memcpy(buf + 4, payload, payloadLen);
     }
-    buf[4 + payloadLen] = checksum(buf + 3, bodyLen);
-    return 5 + payloadLen;
+    if (version == VERSION_2) {
+        putLe32(buf + 3 + bodyLen, crc32(buf + 3, bodyLen));
+    } else {
+        buf[3 + bodyLen] = checksum(buf + 3, bodyLen);
+    }
+    return bodyLen + frameOverhead(version);
+}
+
+// Build a COBS frame, delimiter included, into buf (MAX_COBS_FRAME_LEN
+// bytes is always enough). Returns total frame length.
+inline uint16_t buildCobsFrame(uint8_t* buf, uint8_t msgType,
+                               const uint8_t* payload, uint16_t payloadLen) {
+    uint32_t crc = crc32Update(0, &msgType, 1);
+    if (payload && payloadLen > 0) {
+        crc = crc32Update(crc, payload, payloadLen);
+    }
+    uint8_t trailer[4];
+    putLe32(trailer, crc);
+
+    cobs::Encoder enc(buf);
+    enc.put(msgType);
+    if (payload && payloadLen > 0) {
+        enc.put(payload, payloadLen);
+    }
+    enc.put(trailer, sizeof(trailer));
+    uint16_t len = enc.finish();
+    buf[len++] = COBS_DELIMITER;
+    return len;
+}
+
+// Verify the trailer of a complete frame starting at its start byte.
+inline bool verifyFrame(const uint8_t* frame, uint16_t bodyLen) {
+    const uint8_t* body = frame + 3;
+    if (frame[0] == FRAME_START_BYTE_V2) {
+        return crc32(body, bodyLen) == getLe32(body + bodyLen);
+    }
+    return checksum(body, bodyLen) == body[bodyLen];
 }
 
 } // namespace protocol
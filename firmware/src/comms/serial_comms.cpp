@@ -1,136 +1,479 @@
 #include "serial_comms.h"
 #include <Arduino.h>
+#include <esp_timer.h>
+#include <cstring>
+#include "../util/stats_codec.h"
 
 void SerialComms::begin() {
     // Serial is already initialized by Arduino framework when
     // ARDUINO_USB_CDC_ON_BOOT=1
-    _state = WAIT_START;
+    _rxHead = _rxTail = 0;
+    _rxScanned = 0;
+    _rxCobs = false;
+    _rxVersion = protocol::VERSION_1;
+    _reliable = false;
+    _txFraming = protocol::VERSION_1;
+    _fragments.begin();
+
+    if (!_txTask) {
+        xTaskCreatePinnedToCore(txTask, "serial_tx", TX_TASK_STACK_SIZE, this,
+                                TX_TASK_PRIORITY, &_txTask, ARDUINO_RUNNING_CORE);
+    }
 }
 
 void SerialComms::poll() {
-    // Reset state machine if timeout waiting for frame completion (prevents state machine from getting stuck)
-    if (_state != WAIT_START && (millis() - _lastByteTime) > FRAME_TIMEOUT_MS) {
-        _state = WAIT_START;
-    }
+    const unsigned long now = millis();
 
     // Detect bridge disconnect: connected but no message received within timeout
-    if (_bridgeConnected && _lastMsgTime != 0 && (millis() - _lastMsgTime) > BRIDGE_TIMEOUT_MS) {
+    if (_bridgeConnected && _lastMsgTime != 0 && (now - _lastMsgTime) > BRIDGE_TIMEOUT_MS) {
         _bridgeConnected = false;
         _lastMsgTime = 0;
+        _rxCobs = false;  // Next bridge may be an older one
+        _rxVersion = protocol::VERSION_1;
+        _reliable = false;
+        _txFramingReset = true;
+        if (_txTask) xTaskNotifyGive(_txTask);
         if (_onBridgeDisconnected) _onBridgeDisconnected();
     }
 
-    while (Serial.available()) {
-        uint8_t byte = Serial.read();
-        _lastByteTime = millis();  // Track when we received data
+    bool received = false;
+    while (fillRxBuffer() > 0) {
+        received = true;
+        parseFrames();
+    }
+    if (_ackPending) {
+        sendAck();
+    }
 
-        switch (_state) {
-        case WAIT_START:
-            if (byte == FRAME_START_BYTE) {
-                _state = READ_LEN_HI;
-            }
-            break;
+    if (received) {
+        _lastByteTime = now;
+    } else if (!_rxCobs && _rxHead != _rxTail && (now - _lastByteTime) > FRAME_TIMEOUT_MS) {
+        // A partial frame has been sitting without new bytes — drop it so a
+        // stale header can't swallow the start of the next frame. COBS
+        // framing doesn't need this: the next delimiter resyncs it.
+        _rxHead = _rxTail = 0;
+    }
+}
 
-        case READ_LEN_HI:
-            _bodyLen = (uint16_t)byte << 8;
-            _state = READ_LEN_LO;
-            break;
+// Drain whatever the CDC driver has buffered with a single bulk read.
+// Returns the number of bytes appended to _rxBuf.
+size_t SerialComms::fillRxBuffer() {
+    int avail = Serial.available();
+    if (avail <= 0) return 0;
 
-        case READ_LEN_LO:
-            _bodyLen |= byte;
-            if (_bodyLen == 0 || _bodyLen > MAX_MSG_LEN) {
-                _state = WAIT_START;  // Invalid length
-            } else {
-                _bodyIdx = 0;
-                _state = READ_BODY;
-            }
-            break;
+    // _rxScanned is relative to _rxHead, so it survives the move
+    if (_rxHead > 0 && (size_t)(RX_BUFFER_SIZE - _rxTail) < (size_t)avail) {
+        memmove(_rxBuf, _rxBuf + _rxHead, _rxTail - _rxHead);
+        _rxTail -= _rxHead;
+        _rxHead = 0;
+    }
 
-        case READ_BODY:
-            _buffer[_bodyIdx++] = byte;
-            if (_bodyIdx >= _bodyLen) {
-                _state = READ_CHECKSUM;
-            }
-            break;
+    size_t room = RX_BUFFER_SIZE - _rxTail;
+    if (room < (size_t)avail) _stats.rxWindowStalls++;
+    if (room == 0) return 0;
+    size_t want = (size_t)avail < room ? (size_t)avail : room;
+    // read(buf, len) is the driver's bulk copy out of its RX queue; Stream's
+    // readBytes() would fall back to a timed per-byte loop
+    size_t got = Serial.read(_rxBuf + _rxTail, want);
+    _rxTail += got;
+    _lastRxUs = esp_timer_get_time();
+    return got;
+}
 
-        case READ_CHECKSUM: {
-            uint8_t expected = protocol::checksum(_buffer, _bodyLen);
-            if (byte == expected) {
-                processMessage(_buffer[0], _buffer + 1, _bodyLen - 1);
-            }
-            _state = WAIT_START;
-            break;
+// First v1 or v2 start byte in [p, p + len), or nullptr.
+static uint8_t* findFrameStart(uint8_t* p, size_t len) {
+    uint8_t* v1 = (uint8_t*)memchr(p, FRAME_START_BYTE, len);
+    size_t limit = v1 ? (size_t)(v1 - p) : len;
+    uint8_t* v2 = (uint8_t*)memchr(p, FRAME_START_BYTE_V2, limit);
+    return v2 ? v2 : v1;
+}
+
+// Consume every complete frame in _rxBuf. The framing can change between
+// two frames (MSG_HELLO), so it is re-checked for each one.
+void SerialComms::parseFrames() {
+    while (_rxHead < _rxTail) {
+        bool progressed = _rxCobs ? parseCobsFrame() : parseStartByteFrame();
+        if (!progressed) break;
+    }
+
+    if (_rxHead == _rxTail) {
+        _rxHead = _rxTail = 0;
+        _rxScanned = 0;
+    }
+}
+
+// 0xAA/0xAB framing. Garbage between frames is skipped with memchr; a
+// header with a bad length or a frame with a bad checksum only costs its
+// start byte, so the scan resyncs on the next start byte instead of
+// discarding a whole frame's worth of bytes. Returns false when more bytes
+// are needed.
+bool SerialComms::parseStartByteFrame() {
+    uint8_t* p = _rxBuf + _rxHead;
+    uint16_t avail = _rxTail - _rxHead;
+
+    if (p[0] != FRAME_START_BYTE && p[0] != FRAME_START_BYTE_V2) {
+        uint8_t* start = findFrameStart(p, avail);
+        if (!start) {
+            _rxHead = _rxTail = 0;
+            return false;
         }
+        _rxHead = start - _rxBuf;
+        return true;
+    }
+
+    if (avail < 3) return false;  // Need the length field
+
+    uint16_t bodyLen = ((uint16_t)p[1] << 8) | p[2];
+    if (bodyLen == 0 || bodyLen > MAX_MSG_LEN) {
+        _rxHead++;  // Invalid length
+        return true;
+    }
+
+    uint8_t version = p[0] == FRAME_START_BYTE_V2 ? protocol::VERSION_2 : protocol::VERSION_1;
+    uint16_t frameLen = bodyLen + protocol::frameOverhead(version);
+    if (avail < frameLen) return false;  // Wait for the rest of the frame
+
+    // Once v2 is selected, a v1 frame can only be the MSG_HELLO of a host
+    // starting over; anything else that passes the XOR check is noise
+    bool accepted = version >= _rxVersion || p[3] == MSG_HELLO;
+    if (accepted && protocol::verifyFrame(p, bodyLen)) {
+        _rxHead += frameLen;
+        dispatchFrame(p + 3, bodyLen);
+    } else {
+        _stats.rxBadFrames++;
+        _rxHead++;
+    }
+    return true;
+}
+
+// COBS framing. Everything up to the next 0x00 is one frame; it is decoded
+// in place and checked against its CRC-32. A corrupt or oversized frame is
+// dropped whole and parsing resumes right after its delimiter. Bytes
+// already searched for a delimiter aren't searched again when the rest of
+// a frame arrives. Returns false when more bytes are needed.
+bool SerialComms::parseCobsFrame() {
+    uint8_t* p = _rxBuf + _rxHead;
+    uint16_t avail = _rxTail - _rxHead;
+
+    uint8_t* delim = (uint8_t*)memchr(p + _rxScanned, protocol::COBS_DELIMITER, avail - _rxScanned);
+    if (!delim) {
+        _rxScanned = avail;
+        if (avail > protocol::MAX_COBS_FRAME_LEN) {
+            // No delimiter where one must have been — discard and wait for the next one
+            _rxHead = _rxTail = 0;
+            _rxScanned = 0;
+            _overlongCobsFrame = true;
         }
+        return false;
+    }
+
+    uint16_t encLen = delim - p;
+    _rxHead += encLen + 1;
+    _rxScanned = 0;
+    if (_overlongCobsFrame) {
+        // Tail end of a frame whose start was discarded
+        _overlongCobsFrame = false;
+        return true;
     }
+
+    if (encLen == 0) return true;  // Empty frame, e.g. a host flushing with 0x00
+
+    size_t bodyLen = 0;
+    if (!cobs::decode(p, encLen, p, &bodyLen) ||
+        bodyLen < 5 || bodyLen > protocol::MAX_COBS_BODY_LEN) {  // type + crc32 at least
+        _stats.rxBadFrames++;
+        return true;
+    }
+
+    bodyLen -= 4;
+    if (protocol::crc32(p, bodyLen) == protocol::getLe32(p + bodyLen)) {
+        dispatchFrame(p, bodyLen);
+    } else {
+        _stats.rxBadFrames++;
+    }
+    return true;
+}
+
+// Hand a verified frame body ([SEQ] [MSG_TYPE] [PAYLOAD...] in reliable
+// mode, [MSG_TYPE] [PAYLOAD...] otherwise) to processMessage, enforcing
+// in-order delivery when sequence numbers are on.
+void SerialComms::dispatchFrame(const uint8_t* body, uint16_t bodyLen) {
+    _stats.rxFrames++;
+    _frameUs = esp_timer_get_time();
+    if (!_reliable) {
+        processMessage(body[0], body + 1, bodyLen - 1);
+        return;
+    }
+
+    if (bodyLen < 2) return;
+    uint8_t seq = body[0];
+    _ackPending = true;
+    if (seq == _rxNextSeq) {
+        _rxNextSeq++;
+        processMessage(body[1], body + 2, bodyLen - 2);
+    } else if ((uint8_t)(_rxNextSeq - seq) <= 128) {
+        _stats.rxDuplicates++;  // Already have it — the ACK was lost or late
+    } else {
+        _stats.rxGaps++;        // Something before it went missing
+    }
+}
+
+// Not queued on the bulk lane, where a full lane would drop it and leave
+// a host that waits for credit stuck: the TX task writes the latest one
+// ahead of the next bulk frame, so a newer ACK replaces one not yet sent.
+void SerialComms::sendAck() {
+    _ackPending = false;
+    uint16_t credit = RX_BUFFER_SIZE - (_rxTail - _rxHead);
+    _txAck = ACK_QUEUED | (uint32_t)(uint8_t)(_rxNextSeq - 1) << 16 | credit;
+    if (_txTask) xTaskNotifyGive(_txTask);
 }
 
+// Every host→device message, indexed by type byte at compile time. Types
+// not listed are ignored.
+static constexpr msg::DispatchTable<SerialComms,
+    msg::DisplayText, msg::StatusText, msg::SetLeds, msg::Clear, msg::SetLabels,
+    msg::TextPatch, msg::TextPage, msg::Image, msg::AssetShow, msg::AssetPut, msg::Ping,
+    msg::Hello, msg::Batch, msg::Fragment, msg::GetStats, msg::TimeSync> kDispatch{};
+
 void SerialComms::processMessage(uint8_t msgType, const uint8_t* payload, uint16_t len) {
     _bridgeConnected = true;
     _lastMsgTime = millis();
-    switch (msgType) {
-    case MSG_DISPLAY_TEXT:
-        if (_onDisplayText && len > 0) {
-            _onDisplayText((const char*)payload, len);
-        }
-        break;
+    if (auto dispatch = kDispatch[msgType]) {
+        dispatch(*this, payload, len);
+    }
+}
+
+// Keepalive — timestamp already updated by processMessage. A payload
+// (typically the host's send time) makes it a latency probe: echo it as is.
+void SerialComms::handle(const msg::Ping& m) {
+    if (m.len > 0) {
+        sendFrame(MSG_PONG, m.data, m.len);
+    }
+}
+
+// Host offers its highest protocol version and the features it wants; pick
+// the best version both sides speak. COBS framing needs v2's CRC-32. The
+// host sends in the new framing from its next frame on; device→host frames
+// switch once the TX task has written the reply (see writeFrame()).
+void SerialComms::handle(const msg::Hello& m) {
+    uint8_t selected = m.maxVersion >= protocol::VERSION_2 ? protocol::VERSION_2 : protocol::VERSION_1;
+    uint8_t features = m.features & protocol::SUPPORTED_FEATURES;
+    if (selected < protocol::VERSION_2) features &= ~protocol::FEATURE_COBS;
+
+    uint8_t reply[3] = {protocol::SUPPORTED_VERSIONS, selected, features};
+    sendFrame(MSG_HELLO, reply, sizeof(reply));
+    _rxCobs = (features & protocol::FEATURE_COBS) != 0;
+    _rxVersion = selected;
+    _rxScanned = 0;
+
+    // The sequence restarts with every handshake; the ACK state of a
+    // previous session is meaningless now
+    _reliable = (features & protocol::FEATURE_RELIABLE) != 0;
+    _rxNextSeq = 0;
+    _ackPending = false;
+    _txAck = 0;
+}
+
+// A batch carries several sub-messages that must show up together (e.g.
+// status + text + labels + LEDs for one prompt). The whole container is
+// validated before anything is dispatched, so a malformed batch is dropped
+// as a unit, and the sub-messages are bracketed by the batch callbacks so
+// the display can apply them as one transaction. Batches don't nest and
+// can't carry fragments (a reassembled message may itself be a batch).
+void SerialComms::handle(const msg::Batch& m) {
+    static const uint16_t SUB_HEADER_LEN = 3;  // type + len(2)
 
-    case MSG_STATUS:
-        if (_onStatusText && len > 0) {
-            _onStatusText((const char*)payload, len);
+    uint16_t pos = 0;
+    while (pos < m.len) {
+        if (m.len - pos < SUB_HEADER_LEN) return;
+        uint16_t subLen = msg::getBe16(m.data + pos + 1);
+        uint8_t subType = m.data[pos];
+        if (subType == MSG_BATCH || subType == MSG_FRAGMENT || subLen > m.len - pos - SUB_HEADER_LEN) return;
+        pos += SUB_HEADER_LEN + subLen;
+    }
+
+    if (_onBatchBegin) _onBatchBegin();
+    pos = 0;
+    while (pos < m.len) {
+        uint8_t subType = m.data[pos];
+        uint16_t subLen = msg::getBe16(m.data + pos + 1);
+        processMessage(subType, m.data + pos + SUB_HEADER_LEN, subLen);
+        pos += SUB_HEADER_LEN + subLen;
+    }
+    if (_onBatchEnd) _onBatchEnd();
+}
+
+// Messages above MAX_MSG_LEN (typically long, LZ4-compressed notification
+// text) arrive as fragments; once the last one is in, the reassembled
+// payload is dispatched like any single-frame message.
+void SerialComms::handle(const msg::Fragment& m) {
+    if (_fragments.feed(m.data, m.len)) {
+        processMessage(_fragments.msgType(), _fragments.data(), _fragments.length());
+    }
+}
+
+// Counters are sent as little-endian u32s in the order they appear in the
+// corresponding struct. Ids kept elsewhere are filled in by the stats
+// callback.
+void SerialComms::handle(const msg::GetStats& m) {
+    uint8_t reply[protocol::MAX_STATS_LEN];
+    uint16_t pos = 0;
+    reply[pos++] = m.id;
+
+    switch (m.id) {
+    case protocol::STATS_LINK: {
+        const uint32_t values[] = {
+            _stats.rxFrames, _stats.rxBadFrames, _stats.rxGaps, _stats.rxDuplicates,
+            _stats.rxWindowStalls, _stats.acksSent,
+            _txDropped[TX_LANE_HIGH], _txDropped[TX_LANE_BULK],
+        };
+        for (uint32_t v : values) {
+            protocol::putLe32(reply + pos, v);
+            pos += 4;
         }
         break;
-
-    case MSG_SET_LEDS:
-        if (_onSetLeds && len > 0) {
-            _onSetLeds(payload, len);
+    }
+    case protocol::STATS_BUTTON_LATENCY:
+        pos += protocol::putHistogram(reply + pos, _buttonLatency);
+        break;
+    default:
+        // Kept elsewhere; an unknown id gets just the id back so the host
+        // isn't left waiting
+        if (_onGetStats) {
+            pos += _onGetStats(m.id, m.args, m.argsLen, reply + pos, sizeof(reply) - pos);
         }
         break;
+    }
+    sendFrame(MSG_STATS, reply, pos);
+}
+
+// t1 is echoed untouched, so the host can use any clock it likes
+void SerialComms::handle(const msg::TimeSync& m) {
+    uint8_t reply[24];
+    memcpy(reply, m.t1, 8);
+    protocol::putLe64(reply + 8, (uint64_t)_lastRxUs);
+    protocol::putLe64(reply + 16, (uint64_t)esp_timer_get_time());
+    sendFrame(MSG_TIME_SYNC, reply, sizeof(reply));
+}
 
-    case MSG_CLEAR:
-        if (_onClearDisplay) {
-            _onClearDisplay();
+// Copy into a free slot of the lane and wake the writer. Never blocks: if
+// the lane is full (or the message can't fit its slots) it is dropped and
+// counted.
+bool SerialComms::sendFrame(uint8_t msgType, const uint8_t* payload, uint16_t len,
+                            TxLane lane, int64_t edgeUs) {
+    bool queued = false;
+    if (lane == TX_LANE_HIGH) {
+        auto* slot = _txHigh.acquire();
+        if (slot && len <= sizeof(slot->payload)) {
+            slot->edgeUs = edgeUs;
+            slot->msgType = msgType;
+            slot->len = len;
+            memcpy(slot->payload, payload, len);
+            _txHigh.publish();
+            queued = true;
         }
-        break;
+    } else {
+        auto* slot = _txBulk.acquire();
+        if (slot && len <= sizeof(slot->payload)) {
+            slot->edgeUs = edgeUs;
+            slot->msgType = msgType;
+            slot->len = len;
+            memcpy(slot->payload, payload, len);
+            _txBulk.publish();
+            queued = true;
+        }
+    }
+    if (!queued) {
+        _txDropped[lane]++;
+        return false;
+    }
+    if (_txTask) xTaskNotifyGive(_txTask);
+    return true;
+}
+
+void SerialComms::txTask(void* arg) {
+    SerialComms* self = static_cast<SerialComms*>(arg);
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        self->drainTx();
+    }
+}
 
-    case MSG_PING:
-        break;  // keepalive — timestamp already updated above
-
-    case MSG_SET_LABELS: {
-        if (_onSetLabels && len > 0) {
-            const char* labels[4] = {"", "", "", ""};
-            static char labelBufs[4][32];
-            int labelIdx = 0;
-            uint16_t pos = 0;
-
-            while (pos < len && labelIdx < 4) {
-                uint8_t labelLen = payload[pos++];
-                if (pos + labelLen > len) break;
-                uint8_t copyLen = labelLen < 31 ? labelLen : 31;
-                memcpy(labelBufs[labelIdx], payload + pos, copyLen);
-                labelBufs[labelIdx][copyLen] = '\0';
-                labels[labelIdx] = labelBufs[labelIdx];
-                pos += labelLen;
-                labelIdx++;
+// Serial.write may block while the host is slow to read; that now stalls
+// only this task. The high lane is re-checked before every bulk message so
+// a button event never waits behind more than one frame already on the wire.
+void SerialComms::drainTx() {
+    if (_txFramingReset.exchange(false)) _txFraming = protocol::VERSION_1;
+    for (;;) {
+        if (auto* high = _txHigh.peek()) {
+            writeFrame(high->msgType, high->payload, high->len);
+            if (high->edgeUs) {
+                _buttonLatency.record((uint32_t)(esp_timer_get_time() - high->edgeUs));
             }
-            _onSetLabels(labels);
+            _txHigh.pop();
+        } else if (uint32_t ack = _txAck.exchange(0)) {
+            uint8_t payload[3] = {(uint8_t)(ack >> 16), (uint8_t)(ack >> 8), (uint8_t)ack};
+            writeFrame(MSG_ACK, payload, sizeof(payload));
+            _stats.acksSent++;
+        } else if (auto* bulk = _txBulk.peek()) {
+            writeFrame(bulk->msgType, bulk->payload, bulk->len);
+            _txBulk.pop();
+        } else {
+            break;
         }
-        break;
-    }
     }
 }
 
-void SerialComms::sendFrame(uint8_t msgType, const uint8_t* payload, uint16_t len) {
-    uint8_t frame[MAX_MSG_LEN + 5];
-    uint16_t frameLen = protocol::buildFrame(frame, msgType, payload, len);
-    Serial.write(frame, frameLen);
+// In the framing in force, which only changes here: the MSG_HELLO reply
+// goes out in v1 so any host can read it, and the framing it announces
+// applies from the next frame on. Frames queued before the reply but
+// written after it, like a button event, use the new framing too.
+void SerialComms::writeFrame(uint8_t msgType, const uint8_t* payload, uint16_t len) {
+    uint8_t framing = msgType == MSG_HELLO ? protocol::VERSION_1 : _txFraming.load();
+    if (msgType == MSG_BUTTON_EX && !(framing & TX_BUTTON_TIME)) {
+        msgType = MSG_BUTTON;  // [button, pressed] leads both
+        len = 2;
+    }
+    uint16_t n = framing & TX_COBS
+        ? protocol::buildCobsFrame(_txFrame, msgType, payload, len)
+        : protocol::buildFrame(_txFrame, msgType, payload, len, framing & TX_VERSION_MASK);
+    Serial.write(_txFrame, n);
+
+    if (msgType == MSG_HELLO) {
+        uint8_t features = payload[2];
+        _txFraming = payload[1] |
+                     (features & protocol::FEATURE_COBS ? TX_COBS : 0) |
+                     (features & protocol::FEATURE_BUTTON_TIME ? TX_BUTTON_TIME : 0);
+    }
 }
 
-void SerialComms::sendButtonEvent(uint8_t buttonId, bool pressed) {
-    uint8_t payload[2] = {buttonId, (uint8_t)(pressed ? 1 : 0)};
-    sendFrame(MSG_BUTTON, payload, 2);
+// Always queued as MSG_BUTTON_EX; writeFrame() cuts it down to MSG_BUTTON
+// unless the host asked for FEATURE_BUTTON_TIME
+void SerialComms::sendButtonEvent(uint8_t buttonId, bool pressed, int64_t edgeUs) {
+    uint8_t payload[14];
+    payload[0] = buttonId;
+    payload[1] = pressed ? 1 : 0;
+    protocol::putLe64(payload + 2, (uint64_t)edgeUs);
+    protocol::putLe32(payload + 10, (uint32_t)(esp_timer_get_time() - edgeUs));
+    sendFrame(MSG_BUTTON_EX, payload, sizeof(payload), TX_LANE_HIGH, edgeUs);
 }
 
 void SerialComms::sendHeartbeat(uint8_t status) {
     sendFrame(MSG_HEARTBEAT, &status, 1);
 }
+
+void SerialComms::sendTextRevision(uint16_t rev, uint16_t textLen) {
+    uint8_t payload[4] = {(uint8_t)(rev >> 8), (uint8_t)(rev & 0xFF),
+                          (uint8_t)(textLen >> 8), (uint8_t)(textLen & 0xFF)};
+    sendFrame(MSG_TEXT_REV, payload, sizeof(payload));
+}
+
+void SerialComms::sendAssetMiss(const uint8_t* hash) {
+    sendFrame(MSG_ASSET_MISS, hash, protocol::ASSET_HASH_LEN);
+}
+
+void SerialComms::sendTextPage(uint16_t page, uint16_t pages, TxLane lane) {
+    uint8_t payload[4] = {(uint8_t)(page >> 8), (uint8_t)(page & 0xFF),
+                          (uint8_t)(pages >> 8), (uint8_t)(pages & 0xFF)};
+    sendFrame(MSG_TEXT_PAGE, payload, sizeof(payload), lane);
+}
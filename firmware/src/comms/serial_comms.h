@@ -1,56 +1,184 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "protocol.h"
+#include "messages.h"
+#include "fragment_assembler.h"
+#include "../util/latency_histogram.h"
+#include "../util/spsc_ring.h"
 
 class SerialComms {
 public:
-    using TextCallback   = void (*)(const char* text, uint16_t len);
-    using LedsCallback   = void (*)(const uint8_t* data, uint16_t len);
-    using LabelsCallback = void (*)(const char* labels[4]);
     using VoidCallback   = void (*)();
 
+    // Fills out with the MSG_STATS data for a stats id SerialComms doesn't
+    // keep itself, given the request's args; returns the length written
+    // (0 if unknown)
+    using StatsCallback = uint16_t (*)(uint8_t statsId, const uint8_t* args, uint16_t argsLen,
+                                       uint8_t* out, uint16_t cap);
+
+    // Device→host messages are queued and framed and written by a dedicated
+    // task. Each lane has a single producer: button events go on the high
+    // lane, which the writer always drains before the next bulk message;
+    // everything sent from the comms side goes on the bulk lane.
+    enum TxLane : uint8_t {
+        TX_LANE_HIGH = 0,
+        TX_LANE_BULK = 1,
+    };
+
     void begin();
     void poll();
 
-    void sendButtonEvent(uint8_t buttonId, bool pressed);
+    // edgeUs: esp_timer_get_time() at the raw edge, sent when the host
+    // asked for FEATURE_BUTTON_TIME
+    void sendButtonEvent(uint8_t buttonId, bool pressed, int64_t edgeUs);
     void sendHeartbeat(uint8_t status);
+    void sendTextRevision(uint16_t rev, uint16_t textLen);
+    // From the input task (a local pager button), use TX_LANE_HIGH
+    void sendTextPage(uint16_t page, uint16_t pages, TxLane lane = TX_LANE_BULK);
+    void sendAssetMiss(const uint8_t* hash);
 
     bool bridgeConnected() const { return _bridgeConnected; }
+    // Framing of device→host frames. It switches once the TX task has
+    // written the MSG_HELLO reply, so it can lag the handshake.
+    uint8_t protocolVersion() const { return _txFraming.load() & TX_VERSION_MASK; }
+    bool cobsFraming() const { return (_txFraming.load() & TX_COBS) != 0; }
+    uint32_t txDropped(TxLane lane) const { return _txDropped[lane]; }
+
+    // Link counters, reported to the host as STATS_LINK
+    struct LinkStats {
+        uint32_t rxFrames;        // Frames that passed their checksum
+        uint32_t rxBadFrames;     // Checksum/CRC failures, undecodable COBS frames and
+                                  // v1 frames after v2 was selected
+        uint32_t rxGaps;          // Reliable mode: frames dropped after a missing SEQ
+        uint32_t rxDuplicates;    // Reliable mode: frames with a SEQ already processed
+        uint32_t rxWindowStalls;  // Polls that left bytes in the driver for lack of room
+        uint32_t acksSent;        // Written by the TX task
+    };
+    const LinkStats& linkStats() const { return _stats; }
+
+    // When the frame being processed passed its checksum — for callbacks
+    // that trace latency from frame arrival
+    int64_t frameTimeUs() const { return _frameUs; }
+    const LatencyHistogram& buttonLatency() const { return _buttonLatency; }
+
+    // Register the handler for one of msg::AppMessages; the message type
+    // is deduced from the handler's parameter
+    template <class M>
+    void on(msg::Handler<M> cb) { std::get<msg::Handler<M>>(_handlers) = cb; }
 
-    void onDisplayText(TextCallback cb)       { _onDisplayText = cb; }
-    void onStatusText(TextCallback cb)        { _onStatusText = cb; }
-    void onSetLeds(LedsCallback cb)           { _onSetLeds = cb; }
-    void onClearDisplay(VoidCallback cb)      { _onClearDisplay = cb; }
-    void onSetButtonLabels(LabelsCallback cb) { _onSetLabels = cb; }
     void onBridgeDisconnected(VoidCallback cb){ _onBridgeDisconnected = cb; }
+    void onBatchBegin(VoidCallback cb)        { _onBatchBegin = cb; }
+    void onBatchEnd(VoidCallback cb)          { _onBatchEnd = cb; }
+    void onGetStats(StatsCallback cb)         { _onGetStats = cb; }
 
 private:
+    template <class, class...>
+    friend struct msg::DispatchTable;
+
+    // Dispatch table entry for M: check the length bounds, build the view
+    // and hand it to the matching handle()
+    template <class M>
+    static void dispatch(SerialComms& self, const uint8_t* payload, uint16_t len) {
+        M m;
+        if (len < M::MIN_LEN || len > M::MAX_LEN || !M::parse(payload, len, m)) return;
+        self.handle(m);
+    }
+
+    // Application messages go to the registered handler, if any
+    template <class M>
+    void handle(const M& m) {
+        if (auto cb = std::get<msg::Handler<M>>(_handlers)) cb(m);
+    }
+
+    void handle(const msg::Ping& m);
+    void handle(const msg::Hello& m);
+    void handle(const msg::Batch& m);
+    void handle(const msg::Fragment& m);
+    void handle(const msg::GetStats& m);
+    void handle(const msg::TimeSync& m);
+
     void processMessage(uint8_t msgType, const uint8_t* payload, uint16_t len);
-    void sendFrame(uint8_t msgType, const uint8_t* payload, uint16_t len);
-
-    enum ParseState {
-        WAIT_START,
-        READ_LEN_HI,
-        READ_LEN_LO,
-        READ_BODY,
-        READ_CHECKSUM
-    };
+    bool sendFrame(uint8_t msgType, const uint8_t* payload, uint16_t len,
+                   TxLane lane = TX_LANE_BULK, int64_t edgeUs = 0);
+    static void txTask(void* arg);
+    void drainTx();
+    void writeFrame(uint8_t msgType, const uint8_t* payload, uint16_t len);
+    void dispatchFrame(const uint8_t* body, uint16_t bodyLen);
+    void sendAck();
+
+    size_t fillRxBuffer();
+    void   parseFrames();
+    bool   parseStartByteFrame();
+    bool   parseCobsFrame();
 
-    ParseState _state = WAIT_START;
-    uint8_t    _buffer[MAX_MSG_LEN];
-    uint16_t   _bodyLen = 0;
-    uint16_t   _bodyIdx = 0;
+    // RX staging buffer. Bytes are appended at _rxTail with one bulk read and
+    // consumed from _rxHead; the unconsumed tail is moved back to the start
+    // when the write end runs out, so a frame is always one contiguous span
+    // and can be checksummed and dispatched in place.
+    static const uint16_t RX_BUFFER_SIZE = 2048;
+    uint8_t    _rxBuf[RX_BUFFER_SIZE];
+    uint16_t   _rxHead = 0;
+    uint16_t   _rxTail = 0;
+    uint16_t   _rxScanned = 0;            // COBS: bytes past _rxHead known to hold no delimiter
+    bool       _overlongCobsFrame = false; // COBS: discarding until the next delimiter
     unsigned long _lastByteTime = 0;  // Timeout tracking for frame parser
     unsigned long _lastMsgTime  = 0;  // Time of last complete message received
-    static const unsigned long FRAME_TIMEOUT_MS  = 500;   // Reset parser if no complete frame in 500ms
+    static const unsigned long FRAME_TIMEOUT_MS  = 500;   // Drop a partial frame after 500ms of silence
     static const unsigned long BRIDGE_TIMEOUT_MS = 15000; // Declare disconnected after 15s silence
 
+    FragmentAssembler _fragments;
+
+    // TX lanes: slots hold messages, framed by the TX task as it writes
+    // them so that every frame uses the framing in force on the wire
+    template <uint16_t Size>
+    struct TxSlot {
+        int64_t  edgeUs;  // Button edge behind this message, 0 if none
+        uint8_t  msgType;
+        uint16_t len;
+        uint8_t  payload[Size];
+    };
+    static const uint16_t TX_HIGH_SLOT_SIZE = 16;  // MSG_BUTTON_EX is 14 bytes
+    static const size_t   TX_HIGH_SLOTS = 16;
+    static const size_t   TX_BULK_SLOTS = 8;
+    SpscRing<TxSlot<TX_HIGH_SLOT_SIZE>, TX_HIGH_SLOTS>    _txHigh;
+    SpscRing<TxSlot<MAX_MSG_LEN - 1>, TX_BULK_SLOTS>      _txBulk;
+    uint8_t        _txFrame[protocol::MAX_FRAME_LEN];  // TX task: the message being written
+
+    // Device→host framing in one word, so it is read and switched as a
+    // whole: the protocol version in the low bits, then the TX_* flags.
+    // Only the TX task stores it; the comms task asks for a reset to v1.
+    static const uint8_t TX_VERSION_MASK = 0x0F;
+    static const uint8_t TX_COBS = 0x10;
+    static const uint8_t TX_BUTTON_TIME = 0x20;  // MSG_BUTTON_EX instead of MSG_BUTTON
+    std::atomic<uint8_t> _txFraming{protocol::VERSION_1};
+    std::atomic<bool>    _txFramingReset{false};
+    // The MSG_ACK to write next, as ACK_QUEUED | ack_seq << 16 | credit; 0
+    // if none. The comms task stores it, the TX task takes it.
+    static const uint32_t ACK_QUEUED = 1u << 24;
+    std::atomic<uint32_t> _txAck{0};
+    TaskHandle_t   _txTask = nullptr;
+    uint32_t       _txDropped[2] = {};  // Per lane; written by that lane's producer only
+    LatencyHistogram _buttonLatency;    // Written by the TX task only
+    static const uint32_t TX_TASK_STACK_SIZE = 4096;
+    static const UBaseType_t TX_TASK_PRIORITY = 2;  // Above loop() so queued frames go out promptly
+
     bool           _bridgeConnected = false;
-    TextCallback   _onDisplayText        = nullptr;
-    TextCallback   _onStatusText         = nullptr;
-    LedsCallback   _onSetLeds            = nullptr;
-    VoidCallback   _onClearDisplay       = nullptr;
-    LabelsCallback _onSetLabels          = nullptr;
+    bool           _rxCobs = false;                   // COBS framing negotiated via MSG_HELLO
+    uint8_t        _rxVersion = protocol::VERSION_1;  // Oldest framing accepted, from MSG_HELLO
+    bool           _reliable = false;                 // Sequenced frames negotiated via MSG_HELLO
+    int64_t        _lastRxUs = 0;                     // When the bytes being parsed were read
+    int64_t        _frameUs = 0;                      // When the current frame was verified
+    uint8_t        _rxNextSeq = 0;                    // Reliable mode: next SEQ to accept
+    bool           _ackPending = false;
+    LinkStats      _stats = {};
+    msg::HandlerTuple<msg::AppMessages>::type _handlers = {};
     VoidCallback   _onBridgeDisconnected = nullptr;
+    VoidCallback   _onBatchBegin         = nullptr;
+    VoidCallback   _onBatchEnd           = nullptr;
+    StatsCallback  _onGetStats           = nullptr;
 };
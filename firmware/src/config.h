@@ -14,6 +14,26 @@
 #define SEESAW_BTN_4 4
 #define SEESAW_NEOPIX_PIN 0
 #define SEESAW_NEOPIXEL_COUNT 4
+#define INPUT_POLL_PERIOD_MS 10  // Seesaw has no interrupt line wired, so buttons are sampled
+
+// Buttons (0-3) that page through long notification text on the device
+// itself; they are then not reported to the host. -1 leaves paging to the
+// host via MSG_TEXT_PAGE.
+#define PAGER_PREV_BUTTON -1
+#define PAGER_NEXT_BUTTON -1
+
+// Button (0-3) whose press opens and closes the on-device notification
+// history, also not reported to the host; while it is open the pager
+// buttons scroll it. -1 disables it.
+#define HISTORY_BUTTON -1
+
+// Two buttons (0-3) that, pressed together, open and close the history
+// without giving up a button; the host sees neither press. While it is
+// open, either one alone scrolls it (the second to older entries). A
+// press of either is held back up to 80 ms in case the other follows, so
+// the host gets those two that much later. -1 disables the chord.
+#define HISTORY_CHORD_FIRST 0
+#define HISTORY_CHORD_SECOND 3
 
 // ----- Display: 3-Wire SPI (ST7701 init) -----
 #define PIN_LCD_SPI_CS 0
@@ -82,8 +102,30 @@
 #define MSG_CLEAR 0x05
 #define MSG_SET_LABELS 0x06
 #define MSG_HEARTBEAT 0x07
-#define MSG_PING      0x08  // Host→Device: keepalive (no payload)
+#define MSG_PING      0x08  // Host→Device: keepalive; a payload is echoed in MSG_PONG
+#define MSG_HELLO     0x09  // Both: protocol version negotiation
+#define MSG_BATCH     0x0A  // Host→Device: [type, len_hi, len_lo, payload...] repeated
+#define MSG_FRAGMENT  0x0B  // Host→Device: one piece of a message larger than a frame
+#define MSG_ACK       0x0C  // Device→Host: [ack_seq, credit_hi, credit_lo]
+#define MSG_GET_STATS 0x0D  // Host→Device: [stats_id]
+#define MSG_STATS     0x0E  // Device→Host: [stats_id, data...]
+#define MSG_TEXT_PATCH 0x0F // Host→Device: [op, base_rev_hi, base_rev_lo, args...]
+#define MSG_TEXT_REV  0x10  // Device→Host: [rev_hi, rev_lo, len_hi, len_lo] after a rejected patch
+#define MSG_BUTTON_EX 0x11  // Device→Host: [id, pressed, edge_us(8), latency_us(4)], little-endian
+#define MSG_TIME_SYNC 0x12  // Host→Device: [t1(8)]; Device→Host: [t1(8), t2(8), t3(8)]
+#define MSG_PONG      0x13  // Device→Host: MSG_PING payload echoed back
+#define MSG_TEXT_PAGE 0x14  // Host→Device: [op, page_hi, page_lo]; Device→Host: [page(2), pages(2)]
+#define MSG_IMAGE     0x15  // Host→Device: [x(2), y(2), w(2), h(2), row(2), encoding, data...]
+#define MSG_ASSET_SHOW 0x16 // Host→Device: [hash(16), x(2), y(2)]
+#define MSG_ASSET_MISS 0x17 // Device→Host: [hash(16)] for an MSG_ASSET_SHOW the store doesn't hold
+#define MSG_ASSET_PUT 0x18  // Host→Device: [hash(16), w(2), h(2), encoding, data...]
 
 #define FRAME_START_BYTE 0xAA
+#define FRAME_START_BYTE_V2 0xAB
 #define MAX_MSG_LEN 512
+#define MAX_REASSEMBLED_LEN 8192  // Largest message carried by MSG_FRAGMENT
+#define NOTIF_TEXT_MAX 4096       // Longest notification text shown
+#define STATUS_TEXT_MAX 127       // Longer status text is cut
+#define BUTTON_LABEL_MAX 31
+#define UI_QUEUE_DEPTH 16         // Display commands queued per lane; a power of two
 #define SERIAL_BAUD 115200
@@ -1,6 +1,8 @@
 #include <Arduino.h>
 #include "display_manager.h"
 #include "display_config.h"
+#include "rotate.h"
+#include "image_decoder.h"
 #include <cstring>
 #include <esp_heap_caps.h>
 #include <esp_lcd_panel_rgb.h>
@@ -19,10 +21,148 @@
 #define BYTES_PER_PIXEL 2  // RGB565
 #define BUFF_SIZE (LCD_H_RES * LCD_V_RES * BYTES_PER_PIXEL)
 
+// --- Render modes (-DDISPLAY_RENDER_MODE=...) ---
+// PARTIAL: LVGL renders dirty areas into two PSRAM draw buffers; each area
+//          is rotated into s_rotBuf and copied into the panel framebuffer
+//          by esp_lcd_panel_draw_bitmap. Five full-screen PSRAM buffers.
+// DIRECT:  LVGL keeps the whole landscape screen in one PSRAM buffer. Dirty
+//          areas are rotated straight into the panel's back framebuffer,
+//          which is then swapped in; the areas of the previous frame are
+//          rotated again so the back buffer catches up with the front.
+//          Three full-screen buffers and no intermediate copy.
+// STRIP:   LVGL renders into two small strip buffers in internal DMA-capable
+//          SRAM, where the software blender runs much faster than on PSRAM.
+//          A worker task on the other core rotates each finished strip
+//          straight into the single panel framebuffer while LVGL renders
+//          the next one. One full-screen PSRAM buffer in total.
+#define DISPLAY_RENDER_PARTIAL 0
+#define DISPLAY_RENDER_DIRECT  1
+#define DISPLAY_RENDER_STRIP   2
+#ifndef DISPLAY_RENDER_MODE
+#define DISPLAY_RENDER_MODE DISPLAY_RENDER_PARTIAL
+#endif
+
+#if DISPLAY_RENDER_MODE == DISPLAY_RENDER_STRIP
+// Strip height as a fraction of the landscape screen (-DDISPLAY_STRIP_DIVISOR=...),
+// kept even so strips stay on the rotate kernel's pixel-pair grid
+#ifndef DISPLAY_STRIP_DIVISOR
+#define DISPLAY_STRIP_DIVISOR 10
+#endif
+#define STRIP_LINES ((SCREEN_HEIGHT / DISPLAY_STRIP_DIVISOR) & ~1)
+#define STRIP_SIZE  (STRIP_LINES * SCREEN_WIDTH * BYTES_PER_PIXEL)
+static_assert(STRIP_LINES >= 2, "DISPLAY_STRIP_DIVISOR leaves strips under two lines");
+#define STRIP_TASK_STACK_SIZE  (3 * 1024)
+// Below comms (3), level with serial_tx. A strip is 820x32 pixels, ~52 KB
+// read and written through PSRAM: ~10 us on a desktop (bench_rotate), an
+// estimated 1-3 ms on the S3, against a few tens of microseconds for a
+// comms poll (bench_protocol: ~0.5 us per 400-byte v2 frame on a desktop).
+// Level with comms, the comms task could wait a strip at a time for up to
+// a whole frame of strips; below it, each strip waits at most for one poll.
+// It stays on core 1: on core 0 it would only run while the LVGL task
+// (priority 5) blocks, so rotating would no longer overlap rendering.
+#define STRIP_TASK_PRIORITY    2
+#endif
+
+// --- Frame pacing (-DDISPLAY_FRAME_PACING=1) ---
+// Replaces LVGL's fixed LV_DEF_REFR_PERIOD timer with refreshes started
+// from the panel's vsync, every DISPLAY_PACING_DIVIDER frames (the panel
+// scans out at about 52 Hz: 1 gives ~52 fps, 2 gives ~26 fps). In partial
+// mode, flushes smaller than DISPLAY_PACING_SMALL_PX no longer wait for a
+// whole scan-out: draw_bitmap has already copied them by the time it
+// returns. Missed deadlines and writes that crossed the scan line are
+// counted in DisplayManager::pacingStats().
+#ifndef DISPLAY_FRAME_PACING
+#define DISPLAY_FRAME_PACING 0
+#endif
+#ifndef DISPLAY_PACING_DIVIDER
+#define DISPLAY_PACING_DIVIDER 2
+#endif
+#ifndef DISPLAY_PACING_SMALL_PX
+#define DISPLAY_PACING_SMALL_PX (SCREEN_WIDTH * SCREEN_HEIGHT / 16)
+#endif
+#define LCD_V_TOTAL (LCD_V_RES + LCD_VSYNC_PULSE_WIDTH + LCD_VSYNC_BACK_PORCH + LCD_VSYNC_FRONT_PORCH)
+
+// --- Glyph cache (-DDISPLAY_GLYPH_CACHE_KB=..., 0 to turn it off) ---
+// -DDISPLAY_GLYPH_BENCH=1 times a full-screen text redraw at boot with the
+// cache cold and warm.
+#ifndef DISPLAY_GLYPH_CACHE_KB
+#define DISPLAY_GLYPH_CACHE_KB 128
+#endif
+#ifndef DISPLAY_GLYPH_BENCH
+#define DISPLAY_GLYPH_BENCH 0
+#endif
+
+// --- Notification history ---
+// PSRAM ring of past notifications; at most NotificationHistory::MAX_ENTRIES
+// of them are kept even when they are short.
+#ifndef DISPLAY_HISTORY_KB
+#define DISPLAY_HISTORY_KB 32
+#endif
+
 // --- Static references for C callbacks ---
 static SemaphoreHandle_t s_flushSem = nullptr;
 static SemaphoreHandle_t s_lvglMux = nullptr;
 static uint8_t* s_rotBuf = nullptr;
+static int64_t s_textPendingUs = 0;  // Frame time of the oldest text change not yet flushed
+static LatencyHistogram* s_textLatency = nullptr;
+static LatencyHistogram* s_frameTime = nullptr;
+static int64_t s_refrStartUs = 0;
+static DisplayManager* s_display = nullptr;  // Set once the UI exists
+
+static uint32_t uptimeMs() {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+static bool s_refrFlushed = false;
+
+#if DISPLAY_FRAME_PROFILER
+// Hooks for the per-frame profile; empty when it is compiled out
+static FrameProfiler* s_profiler = nullptr;
+static uint32_t s_lockWaitUs = 0;  // lvgl_task's wait for the lock this round
+#define PROF_START(t)       int64_t t = esp_timer_get_time()
+#define PROF_ADD(field, t)  (s_profiler->current().field += (uint32_t)(esp_timer_get_time() - (t)))
+#define PROF_AREA(a)        (s_profiler->current().areas++, \
+                             s_profiler->current().areaPx += lv_area_get_size(a))
+#else
+#define PROF_START(t)
+#define PROF_ADD(field, t)
+#define PROF_AREA(a)
+#endif
+
+#if DISPLAY_FRAME_PACING
+static DisplayManager::PacingStats* s_pacing = nullptr;
+static TaskHandle_t s_lvglTask = nullptr;
+static portMUX_TYPE s_vsyncLock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_vsyncUs = 0;        // Low 32 bits of esp_timer_get_time()
+static uint32_t s_framePeriodUs = 0;  // Between the last two vsyncs
+static uint32_t s_refrStartVsync = 0;
+static uint32_t s_lastFlushPx = 0;
+#endif
+
+#if DISPLAY_RENDER_MODE == DISPLAY_RENDER_DIRECT
+#define DIRTY_AREAS_MAX 32
+struct DirtyAreas {
+    lv_area_t areas[DIRTY_AREAS_MAX];
+    uint8_t   count;
+    bool      overflow;  // Too many to track: treat the whole screen as dirty
+};
+static uint16_t* s_fbs[2] = {};
+static uint8_t s_backFb = 1;         // The panel starts out scanning fb 0
+static DirtyAreas s_dirty[2] = {};   // This frame's areas and the previous frame's
+static uint8_t s_dirtyCur = 0;
+static bool s_swapPending = false;
+#elif DISPLAY_RENDER_MODE == DISPLAY_RENDER_STRIP
+// The strip handed to the worker; LVGL doesn't touch it until s_stripDone
+struct StripJob {
+    const uint16_t* src;
+    uint32_t  srcStride;  // Pixels
+    lv_area_t area;       // Landscape
+    lv_area_t rotated;    // Portrait, in the framebuffer
+};
+static StripJob s_strip = {};
+static uint16_t* s_fb = nullptr;
+static TaskHandle_t s_stripTask = nullptr;
+static SemaphoreHandle_t s_stripDone = nullptr;
+#endif
 
 // --- ISR: bounce frame finished ---
 IRAM_ATTR static bool on_bounce_frame_finish(esp_lcd_panel_handle_t panel,
@@ -33,10 +173,175 @@ IRAM_ATTR static bool on_bounce_frame_finish(esp_lcd_panel_handle_t panel,
     return high_task_awoken == pdTRUE;
 }
 
+#if DISPLAY_FRAME_PACING
+// --- ISR: vsync; wakes the LVGL task every DISPLAY_PACING_DIVIDER frames ---
+IRAM_ATTR static bool on_vsync(esp_lcd_panel_handle_t panel,
+                               const esp_lcd_rgb_panel_event_data_t* edata,
+                               void* user_ctx) {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    portENTER_CRITICAL_ISR(&s_vsyncLock);
+    if (s_vsyncUs) s_framePeriodUs = now - s_vsyncUs;
+    s_vsyncUs = now;
+    uint32_t vsyncs = ++s_pacing->vsyncs;
+    portEXIT_CRITICAL_ISR(&s_vsyncLock);
+
+    BaseType_t high_task_awoken = pdFALSE;
+    if (vsyncs % DISPLAY_PACING_DIVIDER == 0 && s_lvglTask) {
+        vTaskNotifyGiveFromISR(s_lvglTask, &high_task_awoken);
+    }
+    return high_task_awoken == pdTRUE;
+}
+
+// Where the scan-out is: the frame (vsync count) and the portrait row,
+// estimated from the time since the last vsync. Rows in the blanking
+// interval clamp to the nearest visible one; line is -1 before the
+// period is known.
+struct ScanPos {
+    uint32_t frame;
+    int32_t  line;
+};
+
+static ScanPos scan_pos() {
+    uint32_t now = (uint32_t)esp_timer_get_time();
+    portENTER_CRITICAL(&s_vsyncLock);
+    uint32_t since = now - s_vsyncUs;
+    uint32_t period = s_framePeriodUs;
+    ScanPos pos = {s_pacing->vsyncs, -1};
+    portEXIT_CRITICAL(&s_vsyncLock);
+
+    if (period) {
+        int32_t line = (int32_t)((uint64_t)since * LCD_V_TOTAL / period)
+                       - LCD_VSYNC_PULSE_WIDTH - LCD_VSYNC_BACK_PORCH;
+        pos.line = line < 0 ? 0 : line >= LCD_V_RES ? LCD_V_RES - 1 : line;
+    }
+    return pos;
+}
+
+// A write of portrait rows [y1, y2] that began at start tore if the
+// scan-out passed through those rows before it finished
+static void note_write(ScanPos start, const lv_area_t& rotated) {
+    ScanPos end = scan_pos();
+    if (start.line < 0) return;
+    bool tore;
+    if (end.frame == start.frame) {
+        tore = start.line <= rotated.y2 && end.line >= rotated.y1;
+    } else if (end.frame == start.frame + 1) {
+        tore = start.line <= rotated.y2 || end.line >= rotated.y1;
+    } else {
+        tore = true;  // The write outlasted a whole scan-out
+    }
+    if (tore) s_pacing->tears++;
+}
+#endif
+
+#if DISPLAY_RENDER_MODE == DISPLAY_RENDER_DIRECT
+// Rotate one landscape area of LVGL's full-screen buffer into a portrait
+// framebuffer, at the position lv_display_rotate_area gives it
+static void rotate_to_fb(lv_display_t* disp, const uint16_t* screen, uint16_t* fb,
+                         const lv_area_t* area) {
+    lv_area_t rotated = *area;
+    lv_display_rotate_area(disp, &rotated);
+    rotate90Rgb565(screen + area->y1 * SCREEN_WIDTH + area->x1,
+                   fb + rotated.y1 * LCD_H_RES + rotated.x1,
+                   lv_area_get_width(area), lv_area_get_height(area),
+                   SCREEN_WIDTH, LCD_H_RES);
+}
+
+// --- LVGL flush callback (direct mode) ---
+static void lvgl_flush_cb(lv_display_t* disp, const lv_area_t* area, uint8_t* px_map) {
+    const uint16_t* screen = (const uint16_t*)px_map;
+    uint16_t* back = s_fbs[s_backFb];
+    PROF_AREA(area);
+    PROF_START(rotateStart);
+    rotate_to_fb(disp, screen, back, area);
+    PROF_ADD(rotateUs, rotateStart);
+    s_refrFlushed = true;
+
+    DirtyAreas& cur = s_dirty[s_dirtyCur];
+    if (cur.count < DIRTY_AREAS_MAX) {
+        cur.areas[cur.count++] = *area;
+    } else {
+        cur.overflow = true;
+    }
+    if (!lv_display_flush_is_last(disp)) return;
+
+    // What the front buffer got last frame, the back buffer hasn't seen yet
+    DirtyAreas& prev = s_dirty[s_dirtyCur ^ 1];
+    PROF_START(syncStart);
+    if (prev.overflow) {
+        lv_area_t full = {0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1};
+        rotate_to_fb(disp, screen, back, &full);
+    } else {
+        for (uint8_t i = 0; i < prev.count; i++) {
+            rotate_to_fb(disp, screen, back, &prev.areas[i]);
+        }
+    }
+    PROF_ADD(rotateUs, syncStart);
+    prev.count = 0;
+    prev.overflow = false;
+    s_dirtyCur ^= 1;
+
+    // Passing one of its own framebuffers makes the driver switch to it at
+    // the next frame instead of copying. Drop a stale frame-done signal so
+    // the wait below really waits for the switch.
+    esp_lcd_panel_handle_t panel = (esp_lcd_panel_handle_t)lv_display_get_user_data(disp);
+    xSemaphoreTake(s_flushSem, 0);
+    PROF_START(drawStart);
+    esp_lcd_panel_draw_bitmap(panel, 0, 0, LCD_H_RES, LCD_V_RES, back);
+    PROF_ADD(drawBitmapUs, drawStart);
+    s_backFb ^= 1;
+    s_swapPending = true;
+}
+#elif DISPLAY_RENDER_MODE == DISPLAY_RENDER_STRIP
+// --- Strip worker: rotates finished strips into the panel framebuffer ---
+// The bounce-buffer ISR reads the framebuffer through the same cache the
+// CPU writes it through, so no cache sync or draw_bitmap is needed.
+static void strip_task(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        const StripJob& job = s_strip;
+#if DISPLAY_FRAME_PACING
+        ScanPos start = scan_pos();
+#endif
+        PROF_START(rotateStart);
+        rotate90Rgb565(job.src, s_fb + job.rotated.y1 * LCD_H_RES + job.rotated.x1,
+                       lv_area_get_width(&job.area), lv_area_get_height(&job.area),
+                       job.srcStride, LCD_H_RES);
+        PROF_ADD(rotateUs, rotateStart);
+#if DISPLAY_FRAME_PACING
+        note_write(start, job.rotated);
+#endif
+        xSemaphoreGive(s_stripDone);
+    }
+}
+
+// --- LVGL flush callback (strip mode): hand off and return ---
+static void lvgl_flush_cb(lv_display_t* disp, const lv_area_t* area, uint8_t* px_map) {
+    s_refrFlushed = true;
+    PROF_AREA(area);
+    s_strip.src = (const uint16_t*)px_map;
+    s_strip.srcStride = lv_draw_buf_width_to_stride(lv_area_get_width(area),
+                                                    LV_COLOR_FORMAT_RGB565) / BYTES_PER_PIXEL;
+    s_strip.area = *area;
+    s_strip.rotated = *area;
+    lv_display_rotate_area(disp, &s_strip.rotated);
+    xTaskNotifyGive(s_stripTask);
+}
+#else
 // --- LVGL flush callback (with software rotation) ---
 static void lvgl_flush_cb(lv_display_t* disp, const lv_area_t* area, uint8_t* color_p) {
     esp_lcd_panel_handle_t panel = (esp_lcd_panel_handle_t)lv_display_get_user_data(disp);
+    s_refrFlushed = true;
     lv_display_rotation_t rotation = lv_display_get_rotation(disp);
+#if DISPLAY_FRAME_PACING
+    s_lastFlushPx = lv_area_get_size(area);
+    ScanPos start = scan_pos();
+#endif
+    PROF_AREA(area);
+    // The flush wait takes the frame-done signal this draw causes. Drop one
+    // left over from an earlier frame, e.g. after a small flush that didn't
+    // wait (frame pacing), so the wait can't return before the copy is done.
+    xSemaphoreTake(s_flushSem, 0);
 
     if (rotation != LV_DISPLAY_ROTATION_0 && s_rotBuf) {
         lv_color_format_t cf = lv_display_get_color_format(disp);
@@ -48,19 +353,94 @@ static void lvgl_flush_cb(lv_display_t* disp, const lv_area_t* area, uint8_t* co
 
         int32_t src_w = lv_area_get_width(area);
         int32_t src_h = lv_area_get_height(area);
-        lv_draw_sw_rotate(color_p, s_rotBuf, src_w, src_h, src_stride, dest_stride, rotation, cf);
+        PROF_START(rotateStart);
+        if (rotation == LV_DISPLAY_ROTATION_90 && cf == LV_COLOR_FORMAT_RGB565) {
+            rotate90Rgb565((const uint16_t*)color_p, (uint16_t*)s_rotBuf, src_w, src_h,
+                           src_stride / BYTES_PER_PIXEL, dest_stride / BYTES_PER_PIXEL);
+        } else {
+            lv_draw_sw_rotate(color_p, s_rotBuf, src_w, src_h, src_stride, dest_stride, rotation, cf);
+        }
+        PROF_ADD(rotateUs, rotateStart);
 
+        PROF_START(drawStart);
         esp_lcd_panel_draw_bitmap(panel, rotated_area.x1, rotated_area.y1,
                                   rotated_area.x2 + 1, rotated_area.y2 + 1, s_rotBuf);
+        PROF_ADD(drawBitmapUs, drawStart);
+#if DISPLAY_FRAME_PACING
+        note_write(start, rotated_area);
+#endif
     } else {
+        PROF_START(drawStart);
         esp_lcd_panel_draw_bitmap(panel, area->x1, area->y1,
                                   area->x2 + 1, area->y2 + 1, color_p);
+        PROF_ADD(drawBitmapUs, drawStart);
     }
 }
+#endif
 
 // --- LVGL flush wait callback ---
 static void lvgl_flush_wait_cb(lv_display_t* disp) {
+#if DISPLAY_RENDER_MODE == DISPLAY_RENDER_DIRECT
+    // Only the last area of a refresh hands a buffer to the panel; the old
+    // front buffer is free once the panel has switched away from it
+    if (!s_swapPending) return;
+    s_swapPending = false;
+#endif
+    PROF_START(waitStart);
+#if DISPLAY_RENDER_MODE == DISPLAY_RENDER_STRIP
+    // LVGL has rendered the next strip into the other buffer by now
+    xSemaphoreTake(s_stripDone, portMAX_DELAY);
+#elif DISPLAY_RENDER_MODE == DISPLAY_RENDER_PARTIAL && DISPLAY_FRAME_PACING
+    if (s_lastFlushPx < DISPLAY_PACING_SMALL_PX) {
+        s_pacing->skippedWaits++;
+    } else {
+        xSemaphoreTake(s_flushSem, portMAX_DELAY);
+    }
+#else
     xSemaphoreTake(s_flushSem, portMAX_DELAY);
+#endif
+    PROF_ADD(flushWaitUs, waitStart);
+
+    // Runs under the LVGL lock, like the setters that arm it
+    if (s_textPendingUs && lv_display_flush_is_last(disp)) {
+        s_textLatency->record((uint32_t)(esp_timer_get_time() - s_textPendingUs));
+        s_textPendingUs = 0;
+    }
+}
+
+// Keep dirty areas on even pixel boundaries so every rotation can move
+// whole 32-bit pixel pairs
+static void lvgl_rounder_cb(lv_event_t* e) {
+    lv_area_t* area = (lv_area_t*)lv_event_get_param(e);
+    area->x1 &= ~1;
+    area->y1 &= ~1;
+    area->x2 |= 1;
+    area->y2 |= 1;
+}
+
+// Time each refresh that drew something: render plus rotate/flush
+static void lvgl_refr_event_cb(lv_event_t* e) {
+    if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+        s_refrStartUs = esp_timer_get_time();
+        s_refrFlushed = false;
+#if DISPLAY_FRAME_PACING
+        s_refrStartVsync = s_pacing->vsyncs;
+#endif
+#if DISPLAY_FRAME_PROFILER
+        s_profiler->begin((uint32_t)s_refrStartUs, s_lockWaitUs);
+#endif
+    } else if (s_refrFlushed) {
+        uint32_t totalUs = (uint32_t)(esp_timer_get_time() - s_refrStartUs);
+        s_frameTime->record(totalUs);
+#if DISPLAY_FRAME_PROFILER
+        s_profiler->commit(totalUs);
+#endif
+#if DISPLAY_FRAME_PACING
+        // Still drawing when the next paced refresh was due
+        s_pacing->refreshes++;
+        if (s_pacing->vsyncs - s_refrStartVsync >= DISPLAY_PACING_DIVIDER) s_pacing->missed++;
+#endif
+    }
 }
 
 // --- LVGL tick timer ---
@@ -72,13 +452,27 @@ static void lvgl_tick_cb(void* arg) {
 static void lvgl_task(void* arg) {
     uint32_t task_delay_ms = LVGL_TASK_MAX_DELAY_MS;
     for (;;) {
-        if (xSemaphoreTake(s_lvglMux, portMAX_DELAY) == pdTRUE) {
+#if DISPLAY_FRAME_PACING
+        // Woken by the paced vsync, or earlier when an LVGL timer is due
+        bool refresh = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(task_delay_ms)) > 0;
+#endif
+        PROF_START(lockStart);
+        if (xSemaphoreTakeRecursive(s_lvglMux, portMAX_DELAY) == pdTRUE) {
+#if DISPLAY_FRAME_PROFILER
+            s_lockWaitUs = (uint32_t)(esp_timer_get_time() - lockStart);
+#endif
+            if (s_display) s_display->applyUiCommands();
             task_delay_ms = lv_timer_handler();
-            xSemaphoreGive(s_lvglMux);
+#if DISPLAY_FRAME_PACING
+            if (refresh) lv_refr_now(NULL);
+#endif
+            xSemaphoreGiveRecursive(s_lvglMux);
         }
         if (task_delay_ms > LVGL_TASK_MAX_DELAY_MS) task_delay_ms = LVGL_TASK_MAX_DELAY_MS;
         else if (task_delay_ms < LVGL_TASK_MIN_DELAY_MS) task_delay_ms = LVGL_TASK_MIN_DELAY_MS;
+#if !DISPLAY_FRAME_PACING
         vTaskDelay(pdMS_TO_TICKS(task_delay_ms));
+#endif
     }
 }
 
@@ -129,7 +523,11 @@ void DisplayManager::initPanel() {
     rgb_config.clk_src = LCD_CLK_SRC_DEFAULT;
     rgb_config.psram_trans_align = 64;
     rgb_config.bounce_buffer_size_px = 10 * LCD_H_RES;
+#if DISPLAY_RENDER_MODE == DISPLAY_RENDER_STRIP
+    rgb_config.num_fbs = 1;
+#else
     rgb_config.num_fbs = 2;
+#endif
     rgb_config.data_width = 16;
     rgb_config.bits_per_pixel = 16;
     rgb_config.de_gpio_num = PIN_LCD_DE;
@@ -185,9 +583,11 @@ void DisplayManager::initPanel() {
     ESP_ERROR_CHECK(esp_lcd_new_panel_st7701(io_handle, &panel_config, &_panel));
 
     // Register bounce-frame-finish ISR
-    esp_lcd_rgb_panel_event_callbacks_t cbs = {
-        .on_bounce_frame_finish = on_bounce_frame_finish,
-    };
+    esp_lcd_rgb_panel_event_callbacks_t cbs = {};
+    cbs.on_bounce_frame_finish = on_bounce_frame_finish;
+#if DISPLAY_FRAME_PACING
+    cbs.on_vsync = on_vsync;
+#endif
     ESP_ERROR_CHECK(esp_lcd_rgb_panel_register_event_callbacks(_panel, &cbs, NULL));
 
     ESP_ERROR_CHECK(esp_lcd_panel_reset(_panel));
@@ -199,12 +599,55 @@ void DisplayManager::initPanel() {
 // --- LVGL init ---
 void DisplayManager::initLVGL() {
     lv_init();
+#if DISPLAY_GLYPH_CACHE_KB > 0
+    if (!_glyphs.begin(DISPLAY_GLYPH_CACHE_KB * 1024)) {
+        Serial.println("[display] WARNING: glyph cache allocation failed, drawing uncached");
+    }
+#endif
 
     // Create display (native portrait resolution)
     _disp = lv_display_create(LCD_H_RES, LCD_V_RES);
     lv_display_set_flush_cb(_disp, lvgl_flush_cb);
     lv_display_set_flush_wait_cb(_disp, lvgl_flush_wait_cb);
 
+#if DISPLAY_RENDER_MODE == DISPLAY_RENDER_DIRECT
+    // One landscape buffer holding the whole screen; the panel's own
+    // framebuffers stand in for the second draw buffer and s_rotBuf
+    void* fb0 = nullptr;
+    void* fb1 = nullptr;
+    ESP_ERROR_CHECK(esp_lcd_rgb_panel_get_frame_buffer(_panel, 2, &fb0, &fb1));
+    s_fbs[0] = (uint16_t*)fb0;
+    s_fbs[1] = (uint16_t*)fb1;
+
+    uint8_t* buf1 = (uint8_t*)heap_caps_malloc(BUFF_SIZE, MALLOC_CAP_SPIRAM);
+    if (!buf1) {
+        Serial.println("[display] ERROR: LVGL buffer allocation failed!");
+        return;
+    }
+    lv_display_set_buffers(_disp, buf1, nullptr, BUFF_SIZE, LV_DISPLAY_RENDER_MODE_DIRECT);
+    uint16_t* rotScratch = nullptr;
+    int32_t rotLines = SCREEN_HEIGHT;
+#elif DISPLAY_RENDER_MODE == DISPLAY_RENDER_STRIP
+    void* fb0 = nullptr;
+    ESP_ERROR_CHECK(esp_lcd_rgb_panel_get_frame_buffer(_panel, 1, &fb0));
+    s_fb = (uint16_t*)fb0;
+
+    uint8_t* buf1 = (uint8_t*)heap_caps_malloc(STRIP_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    uint8_t* buf2 = (uint8_t*)heap_caps_malloc(STRIP_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA);
+    if (!buf1 || !buf2) {
+        Serial.println("[display] ERROR: LVGL strip buffer allocation failed!");
+        return;
+    }
+    lv_display_set_buffers(_disp, buf1, buf2, STRIP_SIZE, LV_DISPLAY_RENDER_MODE_PARTIAL);
+
+    s_stripDone = xSemaphoreCreateBinary();
+    xTaskCreatePinnedToCore(strip_task, "lvgl_strip", STRIP_TASK_STACK_SIZE, NULL,
+                            STRIP_TASK_PRIORITY, &s_stripTask, ARDUINO_RUNNING_CORE);
+    uint16_t* rotScratch = nullptr;
+    int32_t rotLines = STRIP_LINES;
+    Serial.printf("[display] Strip renderer: 2 x %d lines (%u bytes) in internal SRAM\n",
+                  STRIP_LINES, (unsigned)STRIP_SIZE);
+#else
     // Allocate LVGL render buffers in PSRAM
     uint8_t* buf1 = (uint8_t*)heap_caps_malloc(BUFF_SIZE, MALLOC_CAP_SPIRAM);
     uint8_t* buf2 = (uint8_t*)heap_caps_malloc(BUFF_SIZE, MALLOC_CAP_SPIRAM);
@@ -213,12 +656,36 @@ void DisplayManager::initLVGL() {
         return;
     }
     lv_display_set_buffers(_disp, buf1, buf2, BUFF_SIZE, LV_DISPLAY_RENDER_MODE_PARTIAL);
-    lv_display_set_user_data(_disp, _panel);
 
-    // Software rotation: 90 degrees for landscape (820x320)
     _rotBuf = (uint8_t*)heap_caps_malloc(BUFF_SIZE, MALLOC_CAP_SPIRAM);
     s_rotBuf = _rotBuf;
+    uint16_t* rotScratch = (uint16_t*)_rotBuf;  // Not in use until the first flush
+    int32_t rotLines = SCREEN_HEIGHT;
+#endif
+    lv_display_set_user_data(_disp, _panel);
+
+    // Software rotation: 90 degrees for landscape (820x320)
     lv_display_set_rotation(_disp, LV_DISPLAY_ROTATION_90);
+    lv_display_add_event_cb(_disp, lvgl_rounder_cb, LV_EVENT_INVALIDATE_AREA, nullptr);
+    lv_display_add_event_cb(_disp, lvgl_refr_event_cb, LV_EVENT_REFR_START, nullptr);
+    lv_display_add_event_cb(_disp, lvgl_refr_event_cb, LV_EVENT_REFR_READY, nullptr);
+#if DISPLAY_FRAME_PACING
+    // Refreshes are started from the vsync instead (see lvgl_task)
+    lv_display_delete_refr_timer(_disp);
+#endif
+    // One full-buffer rotate, timed, so the kernel's cost shows in the boot
+    // log. The panel is already scanning its framebuffers out, so the
+    // rotate goes to a PSRAM buffer of the same size that nothing displays.
+    uint16_t* rotTemp = rotScratch ? nullptr : (uint16_t*)heap_caps_malloc(BUFF_SIZE, MALLOC_CAP_SPIRAM);
+    if (uint16_t* rotDst = rotScratch ? rotScratch : rotTemp) {
+        memset(buf1, 0, (size_t)rotLines * SCREEN_WIDTH * BYTES_PER_PIXEL);
+        int64_t t0 = esp_timer_get_time();
+        rotate90Rgb565((const uint16_t*)buf1, rotDst, SCREEN_WIDTH, rotLines,
+                       SCREEN_WIDTH, SCREEN_HEIGHT);
+        Serial.printf("[display] Rotate of %d lines (kernel %d): %lld us\n",
+                      (int)rotLines, DISPLAY_ROTATE_KERNEL, esp_timer_get_time() - t0);
+    }
+    heap_caps_free(rotTemp);
 
     // LVGL tick timer (2ms)
     const esp_timer_create_args_t tick_args = {
@@ -232,7 +699,11 @@ void DisplayManager::initLVGL() {
     // LVGL task on core 0 — Arduino loop runs on core 1 (ARDUINO_RUNNING_CORE=1),
     // so keeping LVGL on a separate core eliminates task contention over the CPU
     // and prevents LVGL (priority 5) from starving Serial/comms processing.
-    xTaskCreatePinnedToCore(lvgl_task, "LVGL", LVGL_TASK_STACK_SIZE, NULL, LVGL_TASK_PRIORITY, NULL, 0);
+    TaskHandle_t lvglTask = nullptr;
+    xTaskCreatePinnedToCore(lvgl_task, "LVGL", LVGL_TASK_STACK_SIZE, NULL, LVGL_TASK_PRIORITY, &lvglTask, 0);
+#if DISPLAY_FRAME_PACING
+    s_lvglTask = lvglTask;
+#endif
 
     Serial.println("[display] LVGL initialized (820x320 landscape)");
 }
@@ -254,17 +725,21 @@ void DisplayManager::createUI() {
     _statusLabel = lv_label_create(_statusBar);
     lv_label_set_text(_statusLabel, "Ready");
     lv_obj_set_style_text_color(_statusLabel, lv_color_hex(0x00ff00), 0);
-    lv_obj_set_style_text_font(_statusLabel, FONT_STATUS, 0);
+    lv_obj_set_style_text_font(_statusLabel, _glyphs.wrap(FONT_STATUS), 0);
     lv_obj_align(_statusLabel, LV_ALIGN_LEFT_MID, 8, 0);
 
+    _pageLabel = lv_label_create(_statusBar);
+    lv_label_set_text(_pageLabel, "");
+    lv_obj_set_style_text_color(_pageLabel, lv_color_hex(0x8090a0), 0);
+    lv_obj_set_style_text_font(_pageLabel, _glyphs.wrap(FONT_STATUS), 0);
+    lv_obj_align(_pageLabel, LV_ALIGN_RIGHT_MID, -8, 0);
+
     // Notification text area (middle)
-    _notifLabel = lv_label_create(scr);
-    lv_label_set_text(_notifLabel, "");
-    lv_label_set_long_mode(_notifLabel, LV_LABEL_LONG_WRAP);
-    lv_obj_set_width(_notifLabel, SCREEN_WIDTH - 16);
-    lv_obj_set_pos(_notifLabel, 8, 38);
-    lv_obj_set_style_text_color(_notifLabel, lv_color_hex(0xffffff), 0);
-    lv_obj_set_style_text_font(_notifLabel, FONT_NOTIF, 0);
+    _notifView.create(scr, 8, 38, SCREEN_WIDTH - 16, SCREEN_HEIGHT - 66 - 38,
+                      _glyphs.wrap(FONT_NOTIF), lv_color_hex(0xffffff));
+    // History list over the same area, hidden until opened
+    _historyView.create(scr, 8, 38, SCREEN_WIDTH - 16, SCREEN_HEIGHT - 66 - 38,
+                        _glyphs.wrap(FONT_STATUS), &_history);
 
     // Button bar (bottom 70px)
     int btnWidth = SCREEN_WIDTH / 4;
@@ -279,10 +754,49 @@ void DisplayManager::createUI() {
         char label[2] = {(char)('1' + i), '\0'};
         lv_label_set_text(_btnLabels[i], label);
         lv_obj_set_style_text_color(_btnLabels[i], lv_color_hex(0xffffff), 0);
-        lv_obj_set_style_text_font(_btnLabels[i], FONT_BUTTON, 0);
+        lv_obj_set_style_text_font(_btnLabels[i], _glyphs.wrap(FONT_BUTTON), 0);
         lv_obj_center(_btnLabels[i]);
     }
+
+    // Streamed image, given a buffer by the first band of each one
+    _imageCanvas = lv_canvas_create(scr);
+    lv_obj_add_flag(_imageCanvas, LV_OBJ_FLAG_HIDDEN);
+}
+
+#if DISPLAY_GLYPH_BENCH
+// Redraw a screen full of notification text twice: after clearing the
+// glyph cache, then with every glyph cached. Runs under lock() before
+// the LVGL task applies UI commands, so it applies the text itself.
+void DisplayManager::benchmarkGlyphCache() {
+    static const char kSample[] = "The quick brown fox jumps over the lazy dog; "
+                                  "PACK MY BOX WITH FIVE DOZEN LIQUOR JUGS 0123456789. ";
+    const uint16_t sampleLen = sizeof(kSample) - 1;
+    char* slot = notificationTextSlot();
+    uint16_t len = 0;
+    while (len + sampleLen <= 1024) {
+        memcpy(slot + len, kSample, sampleLen);
+        len += sampleLen;
+    }
+    commitNotificationText(len);
+
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 0) _glyphs.clear();
+        applyUiCommands();
+        GlyphCache::Stats before = _glyphs.stats();
+        lv_obj_invalidate(lv_display_get_screen_active(_disp));
+        int64_t t0 = esp_timer_get_time();
+        lv_refr_now(_disp);
+        int64_t us = esp_timer_get_time() - t0;
+        const GlyphCache::Stats& after = _glyphs.stats();
+        Serial.printf("[display] Full-screen text redraw, glyph cache %s: %lld us "
+                      "(%u hits, %u misses, %u glyphs / %u bytes cached)\n",
+                      pass == 0 ? "cold" : "warm", us,
+                      (unsigned)(after.hits - before.hits), (unsigned)(after.misses - before.misses),
+                      (unsigned)after.entries, (unsigned)after.bytes);
+    }
+    commitNotificationText(0);
 }
+#endif
 
 // --- Public API ---
 bool DisplayManager::begin() {
@@ -292,18 +806,46 @@ bool DisplayManager::begin() {
         Serial.println("[display] WARNING: No PSRAM detected!");
         return false;
     }
+    size_t internal_free = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+
+    for (uint8_t i = 0; i < TEXT_SLOTS; i++) {
+        _textArena[i] = (char*)heap_caps_malloc(NOTIF_TEXT_MAX + 1, MALLOC_CAP_SPIRAM);
+        if (!_textArena[i]) {
+            Serial.println("[display] ERROR: text arena allocation failed!");
+            return false;
+        }
+    }
+    if (!_history.begin(DISPLAY_HISTORY_KB * 1024)) {
+        Serial.println("[display] WARNING: history allocation failed, keeping none");
+    }
 
-    _lvglMux = xSemaphoreCreateMutex();
+    _lvglMux = xSemaphoreCreateRecursiveMutex();
     _flushSem = xSemaphoreCreateBinary();
     s_lvglMux = _lvglMux;
     s_flushSem = _flushSem;
+    s_textLatency = &_textLatency;
+    s_frameTime = &_frameTime;
+#if DISPLAY_FRAME_PROFILER
+    s_profiler = &_profiler;
+#endif
+#if DISPLAY_FRAME_PACING
+    s_pacing = &_pacing;
+#endif
 
     initBacklight();
     initPanel();
     initLVGL();
+    Serial.printf("[display] Memory used by display (render mode %d): PSRAM %u KB, internal %u KB\n",
+                  DISPLAY_RENDER_MODE,
+                  (psram_free - heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) / 1024,
+                  (internal_free - heap_caps_get_free_size(MALLOC_CAP_INTERNAL)) / 1024);
 
     if (lock()) {
         createUI();
+#if DISPLAY_GLYPH_BENCH
+        benchmarkGlyphCache();
+#endif
+        s_display = this;
         unlock();
     }
 
@@ -313,39 +855,443 @@ bool DisplayManager::begin() {
 
 bool DisplayManager::lock(int timeout_ms) {
     const TickType_t ticks = (timeout_ms == -1) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
-    return xSemaphoreTake(_lvglMux, ticks) == pdTRUE;
+    return xSemaphoreTakeRecursive(_lvglMux, ticks) == pdTRUE;
 }
 
 void DisplayManager::unlock() {
-    xSemaphoreGive(_lvglMux);
+    xSemaphoreGiveRecursive(_lvglMux);
 }
 
-void DisplayManager::setStatusText(const char* text, uint32_t color) {
-    if (lock()) {
-        lv_label_set_text(_statusLabel, text);
-        lv_obj_set_style_text_color(_statusLabel, lv_color_hex(color), 0);
-        unlock();
+void DisplayManager::beginBatch() {
+    _inBatch = true;
+}
+
+void DisplayManager::endBatch() {
+    _inBatch = false;
+    _uiQueue[UI_LANE_COMMS].publishStaged();
+}
+
+// --- UI command queue ---
+
+// Producer side. Waits only for the LVGL task to drain, which it does at
+// the top of every cycle, never for the lock.
+DisplayManager::UiCommand* DisplayManager::acquireUi(UiLane lane) {
+    SpscRing<UiCommand, UI_QUEUE_DEPTH>& ring = _uiQueue[lane];
+    UiCommand* cmd = ring.acquire();
+    if (!cmd) {
+        ring.publishStaged();  // A batch held back can't be drained
+        _laneCounters[lane].fullWaits++;
+        while (!(cmd = ring.acquire())) vTaskDelay(1);
+    }
+    return cmd;
+}
+
+void DisplayManager::publishUi(UiLane lane) {
+    SpscRing<UiCommand, UI_QUEUE_DEPTH>& ring = _uiQueue[lane];
+    LaneCounters& counters = _laneCounters[lane];
+    if (lane == UI_LANE_COMMS && _inBatch) ring.stage();
+    else ring.publish();
+    counters.enqueued++;
+    uint32_t depth = ring.size() + ring.staged();
+    if (depth > counters.highWater) counters.highWater = depth;
+}
+
+DisplayManager::UiQueueStats DisplayManager::uiQueueStats() const {
+    UiQueueStats stats = {};
+    for (uint8_t lane = 0; lane < 2; lane++) {
+        const LaneCounters& counters = _laneCounters[lane];
+        stats.enqueued += counters.enqueued;
+        stats.fullWaits += counters.fullWaits;
+        if (counters.highWater > stats.highWater) stats.highWater = counters.highWater;
+        stats.depth += _uiQueue[lane].size();
+    }
+    stats.coalesced = _uiCoalesced;
+    return stats;
+}
+
+// Status, labels and text are only set, and the text only laid out, once
+// per drain however many commands for them were queued; a page turn lays
+// out the text first, as it pages through it
+void DisplayManager::applyUiCommands() {
+    // The input lane first, so a page turn isn't held up by a text burst
+    for (UiLane lane : {UI_LANE_INPUT, UI_LANE_COMMS}) {
+        SpscRing<UiCommand, UI_QUEUE_DEPTH>& ring = _uiQueue[lane];
+        while (const UiCommand* cmd = ring.peek()) {
+            applyUiCommand(*cmd);
+            ring.pop();
+        }
+    }
+
+    layoutPendingText();
+    if (_hasPendingStatus) {
+        lv_label_set_text(_statusLabel, _pendingStatus.status.text);
+        lv_obj_set_style_text_color(_statusLabel, lv_color_hex(_pendingStatus.status.color), 0);
+        _hasPendingStatus = false;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (_pendingLabels.labels.mask & (1 << i)) {
+            lv_label_set_text(_btnLabels[i], _pendingLabels.labels.text[i]);
+        }
     }
+    _pendingLabels.labels.mask = 0;
+}
+
+void DisplayManager::applyUiCommand(const UiCommand& cmd) {
+    switch (cmd.kind) {
+    case UiCommand::STATUS:
+        if (_hasPendingStatus) _uiCoalesced++;
+        _pendingStatus = cmd;
+        _hasPendingStatus = true;
+        break;
+
+    case UiCommand::LABELS:
+        if (_pendingLabels.labels.mask & cmd.labels.mask) _uiCoalesced++;
+        for (int i = 0; i < 4; i++) {
+            if (cmd.labels.mask & (1 << i)) {
+                memcpy(_pendingLabels.labels.text[i], cmd.labels.text[i], BUTTON_LABEL_MAX + 1);
+            }
+        }
+        _pendingLabels.labels.mask |= cmd.labels.mask;
+        break;
+
+    case UiCommand::TEXT:
+        if (cmd.text.fresh) archiveText();
+        if (_hasPendingText) {
+            // Superseded: lay out from the first change in either, and time
+            // from the older frame
+            _uiCoalesced++;
+            releaseTextSlot(_pendingText.text.slot);
+            uint16_t from = _pendingText.text.from < cmd.text.from ? _pendingText.text.from
+                                                                   : cmd.text.from;
+            int64_t frameUs = _pendingText.text.frameUs ? _pendingText.text.frameUs
+                                                        : cmd.text.frameUs;
+            _pendingText = cmd;
+            _pendingText.text.from = from;
+            _pendingText.text.frameUs = frameUs;
+        } else {
+            _pendingText = cmd;
+            _hasPendingText = true;
+        }
+        break;
+
+    case UiCommand::PAGE: {
+        layoutPendingText();
+        uint16_t current = _notifView.page();
+        uint16_t page = cmd.page.page;
+        switch (cmd.page.op) {
+        case PAGE_NEXT: page = current + 1; break;
+        case PAGE_PREV: page = current > 0 ? current - 1 : 0; break;
+        default: break;
+        }
+        _notifView.showPage(textIn(_textShown), page);
+        updatePageLabel();
+        _pageReport[cmd.page.lane].store(((uint32_t)(_notifView.page() + 1) << 16) |
+                                         _notifView.pageCount(), std::memory_order_release);
+        if (cmd.page.notify) xTaskNotifyGive(cmd.page.notify);
+        break;
+    }
+
+    case UiCommand::HISTORY_SHOW:
+        if (cmd.history.show) _historyView.show(uptimeMs());
+        else _historyView.hide();
+        _notifView.setHidden(cmd.history.show);
+        updatePageLabel();
+        break;
+
+    case UiCommand::HISTORY_SCROLL:
+        if (_historyView.visible()) {
+            _historyView.scroll(cmd.history.delta, uptimeMs());
+            updatePageLabel();
+        }
+        break;
+
+    case UiCommand::IMAGE_SHOW:
+        if (cmd.image.pixels) {
+            lv_canvas_set_buffer(_imageCanvas, cmd.image.pixels, cmd.image.w, cmd.image.h,
+                                 LV_COLOR_FORMAT_RGB565);
+            lv_obj_set_pos(_imageCanvas, cmd.image.x, cmd.image.y);
+            lv_obj_remove_flag(_imageCanvas, LV_OBJ_FLAG_HIDDEN);
+        } else {
+            lv_obj_add_flag(_imageCanvas, LV_OBJ_FLAG_HIDDEN);
+        }
+        heap_caps_free(_imageShown);
+        _imageShown = cmd.image.pixels;
+        break;
+
+    case UiCommand::IMAGE_ROWS: {
+        lv_area_t area;
+        lv_obj_get_coords(_imageCanvas, &area);
+        area.y1 += cmd.rows.first;
+        area.y2 = area.y1 + cmd.rows.count - 1;
+        lv_obj_invalidate_area(_imageCanvas, &area);
+        break;
+    }
+    }
+}
+
+// A new notification is replacing the current one, shown or still
+// pending: keep the current one in the history. The status label hasn't
+// been changed for the new one yet (that happens at the end of the drain),
+// so it is still the current one's category.
+void DisplayManager::archiveText() {
+    uint8_t slot = _hasPendingText ? _pendingText.text.slot : _textShown;
+    uint16_t len = _hasPendingText ? _pendingText.text.len : _textShownLen;
+    uint32_t now = uptimeMs();
+    if (slot != NO_SLOT && len > 0) {
+        const char* category = lv_label_get_text(_statusLabel);
+        size_t categoryLen = strlen(category);
+        if (categoryLen > UINT8_MAX) categoryLen = UINT8_MAX;
+        _history.add(_textSinceMs, category, categoryLen, _textArena[slot], len);
+        _historyView.onAdded(now);
+        updatePageLabel();
+    }
+    _textSinceMs = now;
+}
+
+void DisplayManager::layoutPendingText() {
+    if (!_hasPendingText) return;
+    const UiCommand::Text& t = _pendingText.text;
+    traceTextChange(_notifView.update(_textArena[t.slot], t.len, t.from), t.frameUs);
+    updatePageLabel();
+    if (_textShown != NO_SLOT) releaseTextSlot(_textShown);
+    _textShown = t.slot;
+    _textShownLen = t.len;
+    _hasPendingText = false;
+}
+
+// --- Setters (producer side) ---
+
+void DisplayManager::setStatusText(const char* text, uint32_t color) {
+    UiCommand* cmd = acquireUi(UI_LANE_COMMS);
+    size_t len = strlen(text);
+    if (len > STATUS_TEXT_MAX) len = STATUS_TEXT_MAX;
+    cmd->kind = UiCommand::STATUS;
+    cmd->status.color = color;
+    memcpy(cmd->status.text, text, len);
+    cmd->status.text[len] = '\0';
+    publishUi(UI_LANE_COMMS);
 }
 
 void DisplayManager::setNotificationText(const char* text) {
-    if (lock()) {
-        lv_label_set_text(_notifLabel, text);
-        unlock();
+    size_t len = strlen(text);
+    if (len > NOTIF_TEXT_MAX) len = NOTIF_TEXT_MAX;
+    memcpy(notificationTextSlot(), text, len);
+    commitNotificationText(len);
+}
+
+// A slot is free once the LVGL task has laid out a newer text, so with
+// TEXT_SLOTS of them a wait means several texts queued within one cycle
+uint8_t DisplayManager::acquireTextSlot() {
+    if (_textBack != NO_SLOT) return _textBack;
+    uint8_t free = _textFree.load(std::memory_order_acquire);
+    if (!free) {
+        _uiQueue[UI_LANE_COMMS].publishStaged();
+        _laneCounters[UI_LANE_COMMS].fullWaits++;
+        while (!(free = _textFree.load(std::memory_order_acquire))) vTaskDelay(1);
+    }
+    _textBack = __builtin_ctz(free);
+    _textFree.fetch_and(~(1 << _textBack), std::memory_order_relaxed);
+    return _textBack;
+}
+
+char* DisplayManager::notificationTextSlot() {
+    return _textArena[acquireTextSlot()];
+}
+
+void DisplayManager::queueText(uint8_t slot, uint16_t len, uint16_t from, bool fresh) {
+    UiCommand* cmd = acquireUi(UI_LANE_COMMS);
+    cmd->kind = UiCommand::TEXT;
+    cmd->text.frameUs = _textFrameUs;
+    cmd->text.len = len;
+    cmd->text.from = from;
+    cmd->text.slot = slot;
+    cmd->text.fresh = fresh;
+    publishUi(UI_LANE_COMMS);
+    _textFrameUs = 0;
+    _textCur = slot;
+    _textBack = NO_SLOT;
+}
+
+void DisplayManager::commitNotificationText(uint16_t len) {
+    if (len > NOTIF_TEXT_MAX) len = NOTIF_TEXT_MAX;
+    uint8_t slot = acquireTextSlot();
+    char* text = _textArena[slot];
+    const char* prev = textIn(_textCur);
+    text[len] = '\0';
+
+    // A host resending the whole text with a few bytes added or changed
+    // only pays for the lines from the first difference on
+    uint16_t common = len < _textLen ? len : _textLen;
+    uint16_t from = 0;
+    while (from < common && text[from] == prev[from]) from++;
+
+    // Text that differs from its first byte is a new notification
+    _textLen = len;
+    _textRev = 0;
+    queueText(slot, len, from, from == 0);
+}
+
+bool DisplayManager::editNotificationText(uint16_t baseRev, uint16_t offset, uint16_t removeLen,
+                                          const char* data, uint16_t len) {
+    if (baseRev != _textRev || offset > _textLen || removeLen > _textLen - offset ||
+        _textLen - removeLen + len > NOTIF_TEXT_MAX) {
+        return false;
+    }
+
+    // The current slot may be on screen, so the edit is made into a copy;
+    // at most NOTIF_TEXT_MAX bytes, next to a refresh that's nothing
+    uint8_t slot = acquireTextSlot();
+    char* text = _textArena[slot];
+    const char* cur = textIn(_textCur);
+    uint16_t tail = _textLen - offset - removeLen;
+    memcpy(text, cur, offset);
+    memcpy(text + offset, data, len);
+    memcpy(text + offset + len, cur + offset + removeLen, tail);
+    _textLen = _textLen - removeLen + len;
+    text[_textLen] = '\0';
+    _textRev++;
+
+    queueText(slot, _textLen, offset, false);
+    return true;
+}
+
+void DisplayManager::showTextPage(PageOp op, uint16_t page, UiLane lane) {
+    UiCommand* cmd = acquireUi(lane);
+    cmd->kind = UiCommand::PAGE;
+    cmd->page.notify = xTaskGetCurrentTaskHandle();
+    cmd->page.page = page;
+    cmd->page.op = op;
+    cmd->page.lane = lane;
+    publishUi(lane);
+}
+
+void DisplayManager::showHistory(bool show, UiLane lane) {
+    UiCommand* cmd = acquireUi(lane);
+    cmd->kind = UiCommand::HISTORY_SHOW;
+    cmd->history.show = show;
+    publishUi(lane);
+}
+
+void DisplayManager::scrollHistory(int16_t delta, UiLane lane) {
+    UiCommand* cmd = acquireUi(lane);
+    cmd->kind = UiCommand::HISTORY_SCROLL;
+    cmd->history.delta = delta;
+    publishUi(lane);
+}
+
+bool DisplayManager::drawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t row,
+                               ImageEncoding encoding, const uint8_t* data, uint16_t len) {
+    uint16_t* pixels = _image;
+    if (row == 0) {
+        // The buffer the LVGL task shows until the next image; unsent rows
+        // show the screen background
+        pixels = (uint16_t*)heap_caps_malloc((uint32_t)w * h * 2, MALLOC_CAP_SPIRAM);
+        if (!pixels) return false;
+        uint16_t bg = image::rgb565(0x10, 0x14, 0x1a);
+        for (uint32_t i = 0; i < (uint32_t)w * h; i++) pixels[i] = bg;
+    } else if (!pixels || x != _imageX || y != _imageY || w != _imageW || h != _imageH) {
+        return false;
+    }
+
+    uint16_t* dst = pixels + (uint32_t)row * w;
+    uint16_t rows = encoding == IMAGE_QOI ? image::decodeQoi(data, len, dst, w, h - row)
+                                          : image::decodeRaw(data, len, dst, w, h - row);
+    if (row == 0) {
+        if (rows == 0) {
+            heap_caps_free(pixels);
+            return false;
+        }
+        queueImage(pixels, x, y, w, h);
+    } else if (rows > 0) {
+        UiCommand* cmd = acquireUi(UI_LANE_COMMS);
+        cmd->kind = UiCommand::IMAGE_ROWS;
+        cmd->rows = {row, rows};
+        publishUi(UI_LANE_COMMS);
+    }
+    return rows > 0;
+}
+
+bool DisplayManager::showImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h,
+                               const uint16_t* pixels) {
+    uint32_t size = (uint32_t)w * h * 2;
+    uint16_t* copy = (uint16_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!copy) return false;
+    memcpy(copy, pixels, size);
+    queueImage(copy, x, y, w, h);
+    return true;
+}
+
+// Hands pixels to the LVGL task, which frees them once they are replaced;
+// the comms side keeps writing to them until the next image
+void DisplayManager::queueImage(uint16_t* pixels, uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+    _image = pixels;
+    _imageX = x;
+    _imageY = y;
+    _imageW = w;
+    _imageH = h;
+    UiCommand* cmd = acquireUi(UI_LANE_COMMS);
+    cmd->kind = UiCommand::IMAGE_SHOW;
+    cmd->image = {pixels, x, y, w, h};
+    publishUi(UI_LANE_COMMS);
+}
+
+void DisplayManager::clearImage() {
+    if (!_image) return;
+    _image = nullptr;
+    UiCommand* cmd = acquireUi(UI_LANE_COMMS);
+    cmd->kind = UiCommand::IMAGE_SHOW;
+    cmd->image = {};
+    publishUi(UI_LANE_COMMS);
+}
+
+bool DisplayManager::takeTextPageReport(UiLane lane, uint16_t& page, uint16_t& pages) {
+    uint32_t report = _pageReport[lane].exchange(0, std::memory_order_acquire);
+    if (!report) return false;
+    page = (report >> 16) - 1;
+    pages = report & 0xFFFF;
+    return true;
+}
+
+// Called with the lock held. While the history is open it shows the
+// position in that instead.
+void DisplayManager::updatePageLabel() {
+    if (_historyView.visible()) {
+        lv_label_set_text_fmt(_pageLabel, "History %u/%u",
+                              _history.count() ? _historyView.top() + 1 : 0, _history.count());
+        return;
+    }
+    uint16_t pages = _notifView.pageCount();
+    if (pages > 1) {
+        lv_label_set_text_fmt(_pageLabel, "%u/%u", _notifView.page() + 1, pages);
+    } else if (lv_label_get_text(_pageLabel)[0] != '\0') {
+        lv_label_set_text(_pageLabel, "");
+    }
+}
+
+// Called with the lock held. Changes that left the screen as it was have
+// no flush to wait for, and the oldest pending change is what counts.
+void DisplayManager::traceTextChange(bool changed, int64_t frameUs) {
+    if (changed && frameUs && !s_textPendingUs) {
+        s_textPendingUs = frameUs;
     }
 }
 
 void DisplayManager::setButtonLabels(const char* btn1, const char* btn2,
                                      const char* btn3, const char* btn4) {
     const char* labels[] = {btn1, btn2, btn3, btn4};
-    if (lock()) {
-        for (int i = 0; i < 4; i++) {
-            if (labels[i]) {
-                lv_label_set_text(_btnLabels[i], labels[i]);
-            }
+    UiCommand* cmd = acquireUi(UI_LANE_COMMS);
+    cmd->kind = UiCommand::LABELS;
+    cmd->labels.mask = 0;
+    for (int i = 0; i < 4; i++) {
+        if (labels[i]) {
+            size_t len = strlen(labels[i]);
+            if (len > BUTTON_LABEL_MAX) len = BUTTON_LABEL_MAX;
+            memcpy(cmd->labels.text[i], labels[i], len);
+            cmd->labels.text[i][len] = '\0';
+            cmd->labels.mask |= 1 << i;
         }
-        unlock();
     }
+    publishUi(UI_LANE_COMMS);
 }
 
 void DisplayManager::showIdleScreen() {
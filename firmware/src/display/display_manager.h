@@ -2,15 +2,107 @@
 
 #include "../config.h"
 #include "lvgl.h"
+#include "text_view.h"
+#include "glyph_cache.h"
+#include "notification_history.h"
+#include "history_view.h"
+#include "../util/latency_histogram.h"
+#include "../util/frame_profiler.h"
+#include "../util/spsc_ring.h"
 #include "esp_lcd_panel_ops.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 
+// UI setters don't touch LVGL: they queue a command that the LVGL task
+// applies before its next refresh, so a caller never waits out a render in
+// progress. The queue has one lane per producing task: every setter is for
+// the comms task (and setup() before it starts), except that the input task
+// may turn pages on UI_LANE_INPUT.
 class DisplayManager {
 public:
+    enum UiLane : uint8_t { UI_LANE_COMMS, UI_LANE_INPUT };
+    enum PageOp : uint8_t { PAGE_GOTO, PAGE_NEXT, PAGE_PREV };
+    enum ImageEncoding : uint8_t { IMAGE_RAW, IMAGE_QOI };
+
     bool begin();
     void setStatusText(const char* text, uint32_t color = 0x00ff00);
     void setNotificationText(const char* text);
+
+    // Zero-copy notification text. The text lives in an arena of PSRAM
+    // slots: callers write up to NOTIF_TEXT_MAX bytes into the slot returned
+    // by notificationTextSlot() (one nothing else reads) and
+    // commitNotificationText() queues it to be shown. Only lines from the
+    // first byte that differs from the previous text are re-laid out.
+    // Waits if every slot is still queued or on screen.
+    char* notificationTextSlot();
+    void commitNotificationText(uint16_t len);
+
+    // Edit the current text: replace removeLen bytes at offset with data,
+    // into a fresh slot as the current one may be on screen. Applies only
+    // if baseRev matches textRevision(), which counts edits since the last
+    // full text (that resets it to 0). Returns
+    // false, changing nothing, on a revision mismatch or out-of-range edit.
+    bool editNotificationText(uint16_t baseRev, uint16_t offset, uint16_t removeLen,
+                              const char* data, uint16_t len);
+    uint16_t textRevision() const { return _textRev; }
+    uint16_t notificationTextLength() const { return _textLen; }
+
+    // Notification pager; a page past the end shows the last one. Once the
+    // LVGL task has turned the page it notifies the calling task, which
+    // then finds where the pager stands in takeTextPageReport(lane).
+    void showTextPage(PageOp op, uint16_t page, UiLane lane = UI_LANE_COMMS);
+    bool takeTextPageReport(UiLane lane, uint16_t& page, uint16_t& pages);
+
+    // Notification history: a notification replaced by a new one (text
+    // that differs from its first byte) is kept in a PSRAM ring, with the
+    // status shown beside it as its category, and listed newest first over
+    // the notification area. Device-side only; no host traffic.
+    void showHistory(bool show, UiLane lane = UI_LANE_INPUT);
+    void scrollHistory(int16_t delta, UiLane lane = UI_LANE_INPUT);
+
+    // An RGB565 image over the UI, streamed in bands of rows (see
+    // protocol::IMAGE_*). Row 0 allocates the image in PSRAM and replaces
+    // the one shown; later bands decode straight into the displayed buffer,
+    // so the image fills in as they arrive and only their rows are redrawn.
+    // Returns false if the band doesn't belong to the current image or
+    // decodes to no rows.
+    bool drawImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t row,
+                   ImageEncoding encoding, const uint8_t* data, uint16_t len);
+    void clearImage();
+    // A whole image at once, copied from pixels
+    bool showImage(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint16_t* pixels);
+
+    // Latency tracing: the next text change is timed from frameUs (when its
+    // frame arrived) until the refresh that shows it has been flushed.
+    void markTextFrame(int64_t frameUs) { _textFrameUs = frameUs; }
+    const LatencyHistogram& textLatency() const { return _textLatency; }
+    // Duration of each refresh that drew something (render + flush)
+    const LatencyHistogram& frameTime() const { return _frameTime; }
+
+    // Frame pacing counters; all zero unless built with DISPLAY_FRAME_PACING
+    struct PacingStats {
+        uint32_t vsyncs;        // Panel scan-outs started
+        uint32_t refreshes;     // Paced refreshes that drew something
+        uint32_t missed;        // ...and were still drawing when the next one was due
+        uint32_t tears;         // Writes the scan-out passed through (estimated)
+        uint32_t skippedWaits;  // Small flushes that didn't wait for a scan-out
+    };
+    const PacingStats& pacingStats() const { return _pacing; }
+    const GlyphCache::Stats& glyphCacheStats() const { return _glyphs.stats(); }
+#if DISPLAY_FRAME_PROFILER
+    const FrameProfiler& frameProfiler() const { return _profiler; }
+#endif
+
+    struct UiQueueStats {
+        uint32_t enqueued;
+        uint32_t coalesced;  // Superseded by a later command before being applied
+        uint32_t fullWaits;  // A setter found the queue or text arena full and waited
+        uint32_t highWater;  // Most commands queued at once, in any lane
+        uint32_t depth;      // Queued now
+    };
+    UiQueueStats uiQueueStats() const;
+
     void setButtonLabels(const char* btn1, const char* btn2,
                          const char* btn3, const char* btn4);
     void showIdleScreen();
@@ -19,14 +111,64 @@ public:
     void update();
 
     // Must be called from any thread before touching LVGL objects
+    // directly; the setters don't need it. The mutex is recursive.
     bool lock(int timeout_ms = -1);
     void unlock();
 
+    // Group several comms-lane setter calls into one display transaction:
+    // their commands are queued together at endBatch(), so the changes
+    // land in a single refresh with no intermediate states on screen. A
+    // batch too big for the queue is split rather than waited on.
+    void beginBatch();
+    void endBatch();
+
+    // Called by the LVGL task, with the lock held, before each
+    // lv_timer_handler()
+    void applyUiCommands();
+
 private:
     void initPanel();
     void initLVGL();
     void initBacklight();
     void createUI();
+    void traceTextChange(bool changed, int64_t frameUs);
+    void benchmarkGlyphCache();
+    void updatePageLabel();
+
+    struct UiCommand {
+        enum Kind : uint8_t { STATUS, TEXT, PAGE, LABELS, HISTORY_SHOW, HISTORY_SCROLL,
+                              IMAGE_SHOW, IMAGE_ROWS };
+        struct Status  { uint32_t color; char text[STATUS_TEXT_MAX + 1]; };
+        struct Text    { int64_t frameUs; uint16_t len; uint16_t from; uint8_t slot; bool fresh; };
+        struct Page    { TaskHandle_t notify; uint16_t page; PageOp op; UiLane lane; };
+        struct Labels  { uint8_t mask; char text[4][BUTTON_LABEL_MAX + 1]; };
+        struct History { bool show; int16_t delta; };
+        struct Image   { uint16_t* pixels; uint16_t x, y, w, h; };  // pixels null to remove
+        struct Rows    { uint16_t first, count; };
+        Kind kind;
+        union {
+            Status  status;
+            Text    text;
+            Page    page;
+            Labels  labels;
+            History history;
+            Image   image;
+            Rows    rows;
+        };
+    };
+    UiCommand* acquireUi(UiLane lane);
+    void publishUi(UiLane lane);
+    void applyUiCommand(const UiCommand& cmd);
+    void layoutPendingText();
+    void archiveText();
+    void queueImage(uint16_t* pixels, uint16_t x, uint16_t y, uint16_t w, uint16_t h);
+
+    uint8_t acquireTextSlot();
+    void queueText(uint8_t slot, uint16_t len, uint16_t from, bool fresh);
+    const char* textIn(uint8_t slot) const { return slot == NO_SLOT ? "" : _textArena[slot]; }
+    void releaseTextSlot(uint8_t slot) {
+        _textFree.fetch_or(1 << slot, std::memory_order_release);
+    }
 
     esp_lcd_panel_handle_t _panel = nullptr;
     lv_display_t* _disp = nullptr;
@@ -37,7 +179,59 @@ private:
     // LVGL UI objects
     lv_obj_t* _statusBar = nullptr;
     lv_obj_t* _statusLabel = nullptr;
-    lv_obj_t* _notifLabel = nullptr;
+    lv_obj_t* _pageLabel = nullptr;  // "page/pages" while the text has more than one
+    TextView  _notifView;
     lv_obj_t* _btnObjs[4] = {};
     lv_obj_t* _btnLabels[4] = {};
+    GlyphCache _glyphs;  // Wraps the UI fonts; LVGL task only
+    NotificationHistory _history;  // LVGL task only
+    HistoryView _historyView;
+    lv_obj_t* _imageCanvas = nullptr;  // Over everything, hidden without an image
+    uint16_t* _imageShown = nullptr;   // LVGL task: the canvas buffer, freed when replaced
+
+    // UI command lanes; the producing task fills and publishes, the LVGL
+    // task drains
+    struct LaneCounters {
+        uint32_t enqueued;
+        uint32_t fullWaits;
+        uint32_t highWater;
+    };
+    SpscRing<UiCommand, UI_QUEUE_DEPTH> _uiQueue[2];
+    LaneCounters _laneCounters[2] = {};  // Each written by its lane's producer
+    bool _inBatch = false;
+    uint32_t _uiCoalesced = 0;           // LVGL task
+    std::atomic<uint32_t> _pageReport[2] = {};  // (page + 1) << 16 | pages, 0 when taken
+
+    // Notification text arena. A slot is owned by the comms side while it
+    // is written, then by the queue, then by the LVGL task until a newer
+    // text replaces it on screen; only the comms side writes, and only
+    // free slots.
+    static const uint8_t TEXT_SLOTS = 4;
+    static const uint8_t NO_SLOT = 0xFF;
+    char* _textArena[TEXT_SLOTS] = {};
+    std::atomic<uint8_t> _textFree{(1 << TEXT_SLOTS) - 1};
+    // Comms side
+    uint8_t _textBack = NO_SLOT;     // Handed out by notificationTextSlot()
+    uint8_t _textCur = NO_SLOT;      // Last committed; patches apply to it
+    uint16_t _textLen = 0;
+    uint16_t _textRev = 0;
+    int64_t _textFrameUs = 0;
+    uint16_t* _image = nullptr;      // Being streamed; still written after it is queued
+    uint16_t _imageX = 0, _imageY = 0, _imageW = 0, _imageH = 0;
+    // LVGL task: the text on screen, and the newest queued one, laid out
+    // once per drain
+    uint8_t _textShown = NO_SLOT;
+    uint16_t _textShownLen = 0;
+    uint32_t _textSinceMs = 0;       // When the notification on screen arrived
+    UiCommand _pendingText = {};
+    UiCommand _pendingStatus = {};   // Status and labels are also set once per drain
+    UiCommand _pendingLabels = {};   // labels.mask 0 when none
+    bool _hasPendingText = false;
+    bool _hasPendingStatus = false;
+    LatencyHistogram _textLatency;  // Written from the LVGL flush path
+    LatencyHistogram _frameTime;    // Written by the LVGL task
+    PacingStats _pacing = {};       // vsyncs from the ISR, the rest from LVGL/strip tasks
+#if DISPLAY_FRAME_PROFILER
+    FrameProfiler _profiler;
+#endif
 };
@@ -0,0 +1,164 @@
+#include "glyph_cache.h"
+#include <cstring>
+#include <esp_heap_caps.h>
+
+bool GlyphCache::begin(uint32_t budgetBytes) {
+    _entries = (Entry*)heap_caps_calloc(MAX_ENTRIES, sizeof(Entry), MALLOC_CAP_SPIRAM);
+    if (!_entries) return false;
+    _budget = budgetBytes;
+    for (uint16_t b = 0; b < BUCKETS; b++) _buckets[b] = NONE;
+    for (uint16_t i = 0; i < MAX_ENTRIES; i++) {
+        _entries[i].hashNext = i + 1 < MAX_ENTRIES ? i + 1 : NONE;
+    }
+    _free = 0;
+    return true;
+}
+
+const lv_font_t* GlyphCache::wrap(const lv_font_t* base) {
+    if (!_entries) return base;
+    for (uint8_t p = 0; p < _proxyCount; p++) {
+        if (_proxies[p].base == base) return &_proxies[p].font;
+    }
+    if (_proxyCount == MAX_FONTS) return base;
+
+    Proxy& proxy = _proxies[_proxyCount++];
+    proxy.font = *base;  // Metrics, kerning and fallback stay the base font's
+    proxy.font.get_glyph_dsc = getGlyphDsc;
+    proxy.font.get_glyph_bitmap = getGlyphBitmap;
+    proxy.font.release_glyph = releaseGlyph;
+    proxy.font.user_data = &proxy;
+    proxy.base = base;
+    proxy.cache = this;
+    return &proxy.font;
+}
+
+void GlyphCache::clear() {
+    while (_lruTail != NONE) evictOldest();
+}
+
+// lv_font_get_glyph_dsc() marks the proxy as the resolved font, so the
+// bitmap request comes back here
+bool GlyphCache::getGlyphDsc(const lv_font_t* font, lv_font_glyph_dsc_t* dsc,
+                             uint32_t letter, uint32_t letterNext) {
+    const lv_font_t* base = ((const Proxy*)font->user_data)->base;
+    return base->get_glyph_dsc(base, dsc, letter, letterNext);
+}
+
+// The base font's callbacks read their tables through dsc->resolved_font
+static const void* baseBitmap(const lv_font_t* base, lv_font_glyph_dsc_t* dsc,
+                              lv_draw_buf_t* drawBuf) {
+    const lv_font_t* proxy = dsc->resolved_font;
+    dsc->resolved_font = base;
+    const void* bitmap = base->get_glyph_bitmap(dsc, drawBuf);
+    dsc->resolved_font = proxy;
+    return bitmap;
+}
+
+const void* GlyphCache::getGlyphBitmap(lv_font_glyph_dsc_t* dsc, lv_draw_buf_t* drawBuf) {
+    const Proxy* proxy = (const Proxy*)dsc->resolved_font->user_data;
+    GlyphCache& cache = *proxy->cache;
+
+    // Only bitmap glyphs rendered into LVGL's buffer can be cached
+    bool bitmapGlyph = dsc->format >= LV_FONT_GLYPH_FORMAT_A1 &&
+                       dsc->format <= LV_FONT_GLYPH_FORMAT_A8;
+    if (!drawBuf || !bitmapGlyph) return baseBitmap(proxy->base, dsc, drawBuf);
+
+    uint16_t i = cache.find(proxy->base, dsc->gid.index);
+    if (i != NONE) {
+        cache._stats.hits++;
+        cache.touch(i);
+        return &cache._entries[i].buf;
+    }
+
+    cache._stats.misses++;
+    const void* bitmap = baseBitmap(proxy->base, dsc, drawBuf);
+    if (bitmap == drawBuf) cache.insert(proxy->base, dsc->gid.index, drawBuf);
+    return bitmap;
+}
+
+void GlyphCache::releaseGlyph(const lv_font_t* font, lv_font_glyph_dsc_t* dsc) {
+    const lv_font_t* base = ((const Proxy*)font->user_data)->base;
+    if (!base->release_glyph) return;
+    dsc->resolved_font = base;
+    base->release_glyph(base, dsc);
+    dsc->resolved_font = font;
+}
+
+uint16_t GlyphCache::bucketOf(const lv_font_t* font, uint32_t gid) {
+    uint32_t h = ((uint32_t)(uintptr_t)font >> 4) * 0x9E3779B1u ^ gid * 0x85EBCA77u;
+    return (h >> 16) & (BUCKETS - 1);
+}
+
+uint16_t GlyphCache::find(const lv_font_t* font, uint32_t gid) const {
+    for (uint16_t i = _buckets[bucketOf(font, gid)]; i != NONE; i = _entries[i].hashNext) {
+        if (_entries[i].font == font && _entries[i].gid == gid) return i;
+    }
+    return NONE;
+}
+
+void GlyphCache::insert(const lv_font_t* font, uint32_t gid, const lv_draw_buf_t* src) {
+    uint32_t size = src->header.stride * src->header.h;
+    if (size == 0 || size > _budget) return;
+    while (_free == NONE || _stats.bytes + size > _budget) evictOldest();
+
+    void* data = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!data) return;
+    memcpy(data, src->data, size);
+
+    uint16_t i = _free;
+    Entry& e = _entries[i];
+    _free = e.hashNext;
+    e.font = font;
+    e.gid = gid;
+    lv_draw_buf_init(&e.buf, src->header.w, src->header.h, (lv_color_format_t)src->header.cf,
+                     src->header.stride, data, size);
+
+    uint16_t& bucket = _buckets[bucketOf(font, gid)];
+    e.hashNext = bucket;
+    bucket = i;
+    e.lruPrev = NONE;
+    e.lruNext = _lruHead;
+    if (_lruHead != NONE) _entries[_lruHead].lruPrev = i;
+    _lruHead = i;
+    if (_lruTail == NONE) _lruTail = i;
+
+    _stats.entries++;
+    _stats.bytes += size;
+}
+
+void GlyphCache::evictOldest() {
+    uint16_t i = _lruTail;
+    Entry& e = _entries[i];
+    lruUnlink(i);
+
+    uint16_t* link = &_buckets[bucketOf(e.font, e.gid)];
+    while (*link != i) link = &_entries[*link].hashNext;
+    *link = e.hashNext;
+
+    _stats.bytes -= e.buf.data_size;
+    _stats.entries--;
+    _stats.evictions++;
+    heap_caps_free(e.buf.data);
+    e.font = nullptr;
+    e.hashNext = _free;
+    _free = i;
+}
+
+void GlyphCache::touch(uint16_t i) {
+    if (_lruHead == i) return;
+    lruUnlink(i);
+    Entry& e = _entries[i];
+    e.lruPrev = NONE;
+    e.lruNext = _lruHead;
+    if (_lruHead != NONE) _entries[_lruHead].lruPrev = i;
+    _lruHead = i;
+    if (_lruTail == NONE) _lruTail = i;
+}
+
+void GlyphCache::lruUnlink(uint16_t i) {
+    Entry& e = _entries[i];
+    if (e.lruPrev != NONE) _entries[e.lruPrev].lruNext = e.lruNext;
+    else _lruHead = e.lruNext;
+    if (e.lruNext != NONE) _entries[e.lruNext].lruPrev = e.lruPrev;
+    else _lruTail = e.lruPrev;
+}
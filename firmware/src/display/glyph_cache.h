@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include "lvgl.h"
+
+// Rendered glyph bitmaps for the built-in fonts, kept in PSRAM.
+//
+// LVGL expands every glyph of an lv_font_fmt_txt font from its packed
+// 4 bpp form in flash into an A8 buffer each time it is drawn, so a
+// screen of notification text is unpacked again on every redraw. wrap()
+// returns a proxy font that forwards to the original but answers bitmap
+// requests from this cache, keyed by (font, glyph id): the glyph id stands
+// for the code point, and the font for its size. The least recently used
+// glyph is evicted once the byte budget or entry table is full.
+//
+// Only used from the LVGL task (LV_USE_OS is NONE, so glyphs are drawn one
+// at a time); a returned bitmap stays valid until the next lookup.
+class GlyphCache {
+public:
+    struct Stats {
+        uint32_t hits;
+        uint32_t misses;
+        uint32_t evictions;
+        uint32_t entries;
+        uint32_t bytes;
+    };
+
+    // Allocates the entry table in PSRAM; without it wrap() hands fonts back
+    // unchanged
+    bool begin(uint32_t budgetBytes);
+
+    // Proxy for base, or base itself when all proxy slots are taken
+    const lv_font_t* wrap(const lv_font_t* base);
+
+    void clear();
+    const Stats& stats() const { return _stats; }
+
+private:
+    struct Proxy {
+        lv_font_t        font;  // user_data points back at this Proxy
+        const lv_font_t* base;
+        GlyphCache*      cache;
+    };
+
+    struct Entry {
+        const lv_font_t* font;  // Base font; nullptr when free
+        uint32_t         gid;
+        lv_draw_buf_t    buf;   // A8, data in PSRAM
+        uint16_t         hashNext;
+        uint16_t         lruPrev;
+        uint16_t         lruNext;
+    };
+
+    static bool getGlyphDsc(const lv_font_t* font, lv_font_glyph_dsc_t* dsc,
+                            uint32_t letter, uint32_t letterNext);
+    static const void* getGlyphBitmap(lv_font_glyph_dsc_t* dsc, lv_draw_buf_t* drawBuf);
+    static void releaseGlyph(const lv_font_t* font, lv_font_glyph_dsc_t* dsc);
+
+    uint16_t find(const lv_font_t* font, uint32_t gid) const;
+    void insert(const lv_font_t* font, uint32_t gid, const lv_draw_buf_t* src);
+    void evictOldest();
+    void touch(uint16_t i);
+    void lruUnlink(uint16_t i);
+    static uint16_t bucketOf(const lv_font_t* font, uint32_t gid);
+
+    static const uint8_t  MAX_FONTS = 4;
+    static const uint16_t MAX_ENTRIES = 512;
+    static const uint16_t BUCKETS = 256;  // Power of two
+    static const uint16_t NONE = 0xFFFF;
+
+    Proxy    _proxies[MAX_FONTS] = {};
+    uint8_t  _proxyCount = 0;
+    Entry*   _entries = nullptr;
+    uint16_t _buckets[BUCKETS];
+    uint16_t _free = NONE;      // Free list through hashNext
+    uint16_t _lruHead = NONE;   // Most recently used
+    uint16_t _lruTail = NONE;
+    uint32_t _budget = 0;
+    Stats    _stats = {};
+};
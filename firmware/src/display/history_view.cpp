@@ -0,0 +1,104 @@
+#include "history_view.h"
+#include <cstdio>
+#include <cstring>
+
+void HistoryView::create(lv_obj_t* parent, int32_t x, int32_t y, int32_t w, int32_t h,
+                         const lv_font_t* font, const NotificationHistory* history) {
+    _history = history;
+    int32_t rowHeight = lv_font_get_line_height(font) + 6;
+    int32_t rows = h / rowHeight;
+    _rows = rows < 1 ? 1 : rows > MAX_ROWS ? MAX_ROWS : rows;
+
+    for (uint8_t r = 0; r < _rows; r++) {
+        lv_obj_t* meta = lv_label_create(parent);
+        lv_label_set_long_mode(meta, LV_LABEL_LONG_DOT);
+        lv_label_set_text(meta, "");
+        lv_obj_set_width(meta, META_WIDTH);
+        lv_obj_set_pos(meta, x, y + r * rowHeight);
+        lv_obj_set_style_text_color(meta, lv_color_hex(0x8090a0), 0);
+        lv_obj_set_style_text_font(meta, font, 0);
+        lv_obj_add_flag(meta, LV_OBJ_FLAG_HIDDEN);
+        _metaLabels[r] = meta;
+
+        lv_obj_t* text = lv_label_create(parent);
+        lv_label_set_long_mode(text, LV_LABEL_LONG_DOT);
+        lv_label_set_text(text, "");
+        lv_obj_set_width(text, w - META_WIDTH - 8);
+        lv_obj_set_pos(text, x + META_WIDTH + 8, y + r * rowHeight);
+        lv_obj_set_style_text_color(text, lv_color_hex(0xffffff), 0);
+        lv_obj_set_style_text_font(text, font, 0);
+        lv_obj_add_flag(text, LV_OBJ_FLAG_HIDDEN);
+        _textLabels[r] = text;
+    }
+}
+
+void HistoryView::show(uint32_t nowMs) {
+    _top = 0;
+    bindRows(nowMs);
+    if (_visible) return;
+    for (uint8_t r = 0; r < _rows; r++) {
+        lv_obj_remove_flag(_metaLabels[r], LV_OBJ_FLAG_HIDDEN);
+        lv_obj_remove_flag(_textLabels[r], LV_OBJ_FLAG_HIDDEN);
+    }
+    _visible = true;
+}
+
+void HistoryView::hide() {
+    if (!_visible) return;
+    for (uint8_t r = 0; r < _rows; r++) {
+        lv_obj_add_flag(_metaLabels[r], LV_OBJ_FLAG_HIDDEN);
+        lv_obj_add_flag(_textLabels[r], LV_OBJ_FLAG_HIDDEN);
+    }
+    _visible = false;
+}
+
+void HistoryView::scroll(int16_t delta, uint32_t nowMs) {
+    int32_t last = _history->count() > _rows ? _history->count() - _rows : 0;
+    int32_t top = (int32_t)_top + delta;
+    _top = top < 0 ? 0 : top > last ? last : top;
+    bindRows(nowMs);
+}
+
+void HistoryView::onAdded(uint32_t nowMs) {
+    if (!_visible) return;
+    if (_top > 0) _top++;
+    scroll(0, nowMs);
+}
+
+// Show entry _top + r in row r; as in TextView, only labels whose text
+// changed are handed to LVGL. The labels keep their own copies, as
+// LV_LABEL_LONG_DOT writes its dots into the text.
+void HistoryView::bindRows(uint32_t nowMs) {
+    for (uint8_t r = 0; r < _rows; r++) {
+        char meta[META_BYTES] = "";
+        char category[META_BYTES - 8];  // Leaves room for the age
+        char text[ROW_BYTES] = "";
+        NotificationHistory::Entry entry;
+        if (_history->get(_top + r, entry, category, sizeof(category), text, sizeof(text))) {
+            uint32_t age = (nowMs - entry.timeMs) / 1000;
+            if (age < 60) snprintf(meta, sizeof(meta), "%us  %s", (unsigned)age, category);
+            else if (age < 3600) snprintf(meta, sizeof(meta), "%um  %s", (unsigned)(age / 60), category);
+            else snprintf(meta, sizeof(meta), "%uh  %s", (unsigned)(age / 3600), category);
+
+            // First line only; a line the copy may have cut short is cut
+            // again a little earlier, on a character boundary
+            size_t n = strcspn(text, "\r\n");
+            if (n > ROW_BYTES - 8) {
+                n = ROW_BYTES - 8;
+                while (n > 0 && ((uint8_t)text[n] & 0xC0) == 0x80) n--;
+            }
+            text[n] = '\0';
+        } else if (r == 0 && _history->count() == 0) {
+            snprintf(text, sizeof(text), "No notifications yet");
+        }
+
+        if (strcmp(_metaText[r], meta) != 0) {
+            memcpy(_metaText[r], meta, sizeof(meta));
+            lv_label_set_text(_metaLabels[r], meta);
+        }
+        if (strcmp(_rowText[r], text) != 0) {
+            memcpy(_rowText[r], text, sizeof(text));
+            lv_label_set_text(_textLabels[r], text);
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include "lvgl.h"
+#include "notification_history.h"
+
+// Virtualised list of a NotificationHistory, newest first: one row of two
+// labels (age and category, then the first line of text) per visible
+// entry. Scrolling rebinds the same rows to other entries rather than
+// creating objects, so opening or moving the list costs a few label
+// updates however long the history is.
+class HistoryView {
+public:
+    void create(lv_obj_t* parent, int32_t x, int32_t y, int32_t w, int32_t h,
+                const lv_font_t* font, const NotificationHistory* history);
+
+    // Open on the newest entry, or close. Need the LVGL lock, as do the rest.
+    void show(uint32_t nowMs);
+    void hide();
+    bool visible() const { return _visible; }
+
+    // Move delta entries towards older ones (negative: newer), clamped
+    void scroll(int16_t delta, uint32_t nowMs);
+
+    // After an add(): the newest stays on top if it was, otherwise the
+    // entries in view stay put
+    void onAdded(uint32_t nowMs);
+
+    uint16_t top() const { return _top; }
+
+private:
+    void bindRows(uint32_t nowMs);
+
+    static const uint8_t  MAX_ROWS = 8;
+    static const uint16_t META_BYTES = 48;
+    static const uint16_t ROW_BYTES = 160;  // Longer lines are cut with "..." anyway
+    static const int32_t  META_WIDTH = 200;
+
+    const NotificationHistory* _history = nullptr;
+    uint8_t   _rows = 0;
+    lv_obj_t* _metaLabels[MAX_ROWS] = {};
+    lv_obj_t* _textLabels[MAX_ROWS] = {};
+    char      _metaText[MAX_ROWS][META_BYTES] = {};  // As last set, to skip unchanged rows
+    char      _rowText[MAX_ROWS][ROW_BYTES] = {};
+    uint16_t  _top = 0;  // Entry in the first row
+    bool      _visible = false;
+};
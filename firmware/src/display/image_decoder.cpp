@@ -0,0 +1,79 @@
+#include "image_decoder.h"
+#include <cstring>
+
+namespace image {
+
+static const uint32_t QOI_HEADER_LEN = 14;
+static const uint8_t  QOI_OP_RGB = 0xFE;
+static const uint8_t  QOI_OP_RGBA = 0xFF;
+
+static uint32_t getBe32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+uint16_t decodeRaw(const uint8_t* data, uint32_t len, uint16_t* dst,
+                   uint16_t width, uint16_t maxRows) {
+    if (width == 0) return 0;
+    uint32_t rows = len / (width * 2u);
+    if (rows > maxRows) rows = maxRows;
+    memcpy(dst, data, rows * width * 2u);
+    return rows;
+}
+
+uint16_t decodeQoi(const uint8_t* data, uint32_t len, uint16_t* dst,
+                   uint16_t width, uint16_t maxRows) {
+    if (len < QOI_HEADER_LEN || memcmp(data, "qoif", 4) != 0) return 0;
+    uint32_t height = getBe32(data + 8);
+    if (width == 0 || getBe32(data + 4) != width || height == 0 || height > maxRows) return 0;
+
+    uint8_t index[64][4] = {};
+    uint8_t r = 0, g = 0, b = 0, a = 255;
+    uint32_t total = width * height;
+    uint32_t n = 0;
+    uint32_t p = QOI_HEADER_LEN;
+    while (n < total && p < len) {
+        uint8_t op = data[p++];
+        uint32_t run = 1;
+        if (op == QOI_OP_RGB) {
+            if (len - p < 3) break;
+            r = data[p]; g = data[p + 1]; b = data[p + 2];
+            p += 3;
+        } else if (op == QOI_OP_RGBA) {
+            if (len - p < 4) break;
+            r = data[p]; g = data[p + 1]; b = data[p + 2]; a = data[p + 3];
+            p += 4;
+        } else {
+            switch (op >> 6) {
+            case 0:  // INDEX
+                r = index[op][0]; g = index[op][1]; b = index[op][2]; a = index[op][3];
+                break;
+            case 1:  // DIFF
+                r += ((op >> 4) & 3) - 2;
+                g += ((op >> 2) & 3) - 2;
+                b += (op & 3) - 2;
+                break;
+            case 2: {  // LUMA
+                if (p == len) return n / width;
+                uint8_t next = data[p++];
+                int8_t dg = (op & 0x3F) - 32;
+                r += dg - 8 + (next >> 4);
+                g += dg;
+                b += dg - 8 + (next & 0x0F);
+                break;
+            }
+            default:  // RUN of the previous pixel
+                run = (op & 0x3F) + 1;
+                break;
+            }
+        }
+
+        uint8_t* slot = index[(r * 3 + g * 5 + b * 7 + a * 11) & 63];
+        slot[0] = r; slot[1] = g; slot[2] = b; slot[3] = a;
+        uint16_t px = rgb565(r, g, b);
+        if (run > total - n) run = total - n;
+        for (uint32_t i = 0; i < run; i++) dst[n++] = px;
+    }
+    return n / width;
+}
+
+}  // namespace image
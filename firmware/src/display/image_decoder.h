@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Decoders for MSG_IMAGE data. Each writes RGB565 pixels straight to their
+// place in the destination image as they come out of the stream, with no
+// intermediate buffer, and returns how many whole rows it wrote so the
+// caller can redraw just those.
+namespace image {
+
+// Raw RGB565, little-endian, whole rows
+uint16_t decodeRaw(const uint8_t* data, uint32_t len, uint16_t* dst,
+                   uint16_t width, uint16_t maxRows);
+
+// A complete QOI image (qoiformat.org) width pixels wide and at most
+// maxRows high, RGB or RGBA; alpha is dropped. A truncated stream yields
+// the rows it completed.
+uint16_t decodeQoi(const uint8_t* data, uint32_t len, uint16_t* dst,
+                   uint16_t width, uint16_t maxRows);
+
+inline uint16_t rgb565(uint8_t r, uint8_t g, uint8_t b) {
+    return (uint16_t)((r & 0xF8) << 8 | (g & 0xFC) << 3 | b >> 3);
+}
+
+}  // namespace image
@@ -0,0 +1,81 @@
+#include "notification_history.h"
+#include <cstring>
+#include <esp_heap_caps.h>
+
+bool NotificationHistory::begin(uint32_t capacityBytes) {
+    _buf = (uint8_t*)heap_caps_malloc(capacityBytes, MALLOC_CAP_SPIRAM);
+    if (!_buf) return false;
+    _capacity = capacityBytes;
+    return true;
+}
+
+void NotificationHistory::add(uint32_t timeMs, const char* category, uint8_t categoryLen,
+                              const char* text, uint16_t textLen) {
+    uint32_t fixed = (uint32_t)HEADER_LEN + categoryLen;
+    if (!_buf || _capacity < fixed) return;
+    if (fixed + textLen > _capacity) textLen = (uint16_t)(_capacity - fixed);
+    uint32_t size = fixed + textLen;
+    while (_count == MAX_ENTRIES || _capacity - _used < size) dropOldest();
+
+    uint32_t at = (_head + _used) % _capacity;
+    uint8_t header[HEADER_LEN] = {
+        (uint8_t)timeMs, (uint8_t)(timeMs >> 8), (uint8_t)(timeMs >> 16), (uint8_t)(timeMs >> 24),
+        (uint8_t)textLen, (uint8_t)(textLen >> 8), categoryLen,
+    };
+    write(at, header, HEADER_LEN);
+    write(at + HEADER_LEN, category, categoryLen);
+    write(at + HEADER_LEN + categoryLen, text, textLen);
+
+    _offsets[(_first + _count) % MAX_ENTRIES] = at;
+    _count++;
+    _used += size;
+    _added++;
+}
+
+bool NotificationHistory::get(uint16_t i, Entry& entry, char* category, uint16_t categoryCap,
+                              char* text, uint16_t textCap) const {
+    if (i >= _count) return false;
+    uint32_t at = _offsets[(_first + _count - 1 - i) % MAX_ENTRIES];
+    uint8_t header[HEADER_LEN];
+    read(at, header, HEADER_LEN);
+    entry.seq = _added - 1 - i;
+    entry.timeMs = header[0] | header[1] << 8 | header[2] << 16 | (uint32_t)header[3] << 24;
+    entry.textLen = header[4] | header[5] << 8;
+    entry.categoryLen = header[6];
+
+    uint16_t n = entry.categoryLen < categoryCap - 1 ? entry.categoryLen : categoryCap - 1;
+    read(at + HEADER_LEN, category, n);
+    category[n] = '\0';
+    n = entry.textLen < textCap - 1 ? entry.textLen : textCap - 1;
+    read(at + HEADER_LEN + entry.categoryLen, text, n);
+    text[n] = '\0';
+    return true;
+}
+
+void NotificationHistory::write(uint32_t at, const void* src, uint32_t len) {
+    at %= _capacity;
+    uint32_t first = len < _capacity - at ? len : _capacity - at;
+    memcpy(_buf + at, src, first);
+    memcpy(_buf, (const uint8_t*)src + first, len - first);
+}
+
+void NotificationHistory::read(uint32_t at, void* dst, uint32_t len) const {
+    at %= _capacity;
+    uint32_t first = len < _capacity - at ? len : _capacity - at;
+    memcpy(dst, _buf + at, first);
+    memcpy((uint8_t*)dst + first, _buf, len - first);
+}
+
+uint32_t NotificationHistory::entrySize(uint32_t at) const {
+    uint8_t header[HEADER_LEN];
+    read(at, header, HEADER_LEN);
+    return HEADER_LEN + header[6] + (header[4] | header[5] << 8);
+}
+
+void NotificationHistory::dropOldest() {
+    uint32_t size = entrySize(_head);
+    _head = (_head + size) % _capacity;
+    _used -= size;
+    _first = (_first + 1) % MAX_ENTRIES;
+    _count--;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+// The last notifications shown, newest first, in a PSRAM byte ring.
+//
+// Each entry is length-prefixed: [time_ms(4), text_len(2), category_len(1),
+// category, text], little-endian, and may wrap around the end of the ring.
+// Adding one drops the oldest entries until it fits. A small index of entry
+// offsets reaches any entry without walking the ring, so a list view reads
+// just the rows it shows.
+//
+// Only used from the LVGL task.
+class NotificationHistory {
+public:
+    struct Entry {
+        uint32_t seq;          // Counts every notification added since boot
+        uint32_t timeMs;
+        uint16_t textLen;
+        uint8_t  categoryLen;
+    };
+
+    static const uint16_t MAX_ENTRIES = 128;
+
+    // Allocates the ring in PSRAM; without it add() keeps nothing
+    bool begin(uint32_t capacityBytes);
+
+    void add(uint32_t timeMs, const char* category, uint8_t categoryLen,
+             const char* text, uint16_t textLen);
+
+    uint16_t count() const { return _count; }
+
+    // Entry i, 0 being the newest. Its category and the start of its text
+    // are copied NUL-terminated, as much as fits in each buffer.
+    bool get(uint16_t i, Entry& entry, char* category, uint16_t categoryCap,
+             char* text, uint16_t textCap) const;
+
+private:
+    static const uint8_t HEADER_LEN = 7;
+
+    void write(uint32_t at, const void* src, uint32_t len);
+    void read(uint32_t at, void* dst, uint32_t len) const;
+    uint32_t entrySize(uint32_t at) const;
+    void dropOldest();
+
+    uint8_t* _buf = nullptr;
+    uint32_t _capacity = 0;
+    uint32_t _head = 0;   // Offset of the oldest entry
+    uint32_t _used = 0;
+    uint32_t _offsets[MAX_ENTRIES] = {};  // Entry offsets, oldest at _first
+    uint16_t _first = 0;
+    uint16_t _count = 0;
+    uint32_t _added = 0;
+};
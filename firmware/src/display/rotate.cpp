@@ -0,0 +1,78 @@
+#include "rotate.h"
+#include <cstring>
+
+// 32x32 pixels: 2 KB of source and 2 KB of destination per tile, 32 cache
+// lines each way, well inside the S3's PSRAM data cache
+static const int32_t TILE = 32;
+
+static inline void rotateTileScalar(const uint16_t* src, uint16_t* dst, int32_t w,
+                                    int32_t x0, int32_t x1, int32_t y0, int32_t y1,
+                                    int32_t srcStride, int32_t dstStride) {
+    for (int32_t x = x0; x < x1; x++) {
+        uint16_t* d = dst + (w - 1 - x) * dstStride;
+        const uint16_t* s = src + x;
+        for (int32_t y = y0; y < y1; y++) {
+            d[y] = s[y * srcStride];
+        }
+    }
+}
+
+void rotate90Rgb565Scalar(const uint16_t* src, uint16_t* dst, int32_t w, int32_t h,
+                          int32_t srcStride, int32_t dstStride) {
+    for (int32_t ty = 0; ty < h; ty += TILE) {
+        int32_t y1 = ty + TILE < h ? ty + TILE : h;
+        for (int32_t tx = 0; tx < w; tx += TILE) {
+            int32_t x1 = tx + TILE < w ? tx + TILE : w;
+            rotateTileScalar(src, dst, w, tx, x1, ty, y1, srcStride, dstStride);
+        }
+    }
+}
+
+// Word access to pixel pairs the caller has checked are 4-byte aligned;
+// memcpy keeps it well-defined and still compiles to one l32i/s32i
+static inline uint32_t loadPair(const uint16_t* p) {
+    uint32_t v;
+    memcpy(&v, __builtin_assume_aligned(p, 4), 4);
+    return v;
+}
+
+static inline void storePair(uint16_t* p, uint32_t v) {
+    memcpy(__builtin_assume_aligned(p, 4), &v, 4);
+}
+
+// Two source rows a = [p(y,x), p(y,x+1)] and b = [p(y+1,x), p(y+1,x+1)]
+// (little-endian, so the first pixel is the low half) become destination
+// rows [p(y,x), p(y+1,x)] and [p(y,x+1), p(y+1,x+1)].
+void rotate90Rgb565Pairs(const uint16_t* src, uint16_t* dst, int32_t w, int32_t h,
+                         int32_t srcStride, int32_t dstStride) {
+    bool aligned = ((srcStride | dstStride) & 1) == 0 &&
+                   (((uintptr_t)src | (uintptr_t)dst) & 3) == 0;
+    if (!aligned) {
+        rotate90Rgb565Scalar(src, dst, w, h, srcStride, dstStride);
+        return;
+    }
+
+    int32_t wEven = w & ~1;
+    int32_t hEven = h & ~1;
+    for (int32_t ty = 0; ty < hEven; ty += TILE) {
+        int32_t y1 = ty + TILE < hEven ? ty + TILE : hEven;
+        for (int32_t tx = 0; tx < wEven; tx += TILE) {
+            int32_t x1 = tx + TILE < wEven ? tx + TILE : wEven;
+            for (int32_t x = tx; x < x1; x += 2) {
+                uint16_t* d0 = dst + (w - 1 - x) * dstStride;
+                uint16_t* d1 = dst + (w - 2 - x) * dstStride;
+                const uint16_t* s = src + x;
+                for (int32_t y = ty; y < y1; y += 2) {
+                    uint32_t a = loadPair(s + y * srcStride);
+                    uint32_t b = loadPair(s + (y + 1) * srcStride);
+                    storePair(d0 + y, (a & 0xFFFF) | (b << 16));
+                    storePair(d1 + y, (a >> 16) | (b & 0xFFFF0000));
+                }
+            }
+        }
+    }
+
+    // Odd last column and/or row
+    if (wEven < w) rotateTileScalar(src, dst, w, wEven, w, 0, h, srcStride, dstStride);
+    if (hEven < h) rotateTileScalar(src, dst, w, 0, wEven, hEven, h, srcStride, dstStride);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+
+// RGB565 rotation for the landscape flush path, matching what
+// lv_draw_sw_rotate does for LV_DISPLAY_ROTATION_90:
+//
+//   dst[(w - 1 - x) * dstStride + y] = src[y * srcStride + x]
+//
+// Strides are in pixels. The rotation is a transpose through PSRAM, so the
+// naive loop (one row of src, one column of dst) misses the cache on every
+// destination write. Both kernels walk the image in square tiles small
+// enough that a tile's source and destination lines stay cached.
+//
+//   ROTATE_KERNEL_SCALAR  one pixel at a time; the reference
+//   ROTATE_KERNEL_PAIRS   2x2 pixel blocks as 32-bit words: two loads and
+//                         two stores per four pixels
+//
+// The kernel is chosen at build time with -DDISPLAY_ROTATE_KERNEL=...;
+// PAIRS falls back to SCALAR when an area's rows aren't word aligned.
+
+#define ROTATE_KERNEL_SCALAR 0
+#define ROTATE_KERNEL_PAIRS  1
+
+#ifndef DISPLAY_ROTATE_KERNEL
+#define DISPLAY_ROTATE_KERNEL ROTATE_KERNEL_PAIRS
+#endif
+
+void rotate90Rgb565Scalar(const uint16_t* src, uint16_t* dst, int32_t w, int32_t h,
+                          int32_t srcStride, int32_t dstStride);
+void rotate90Rgb565Pairs(const uint16_t* src, uint16_t* dst, int32_t w, int32_t h,
+                         int32_t srcStride, int32_t dstStride);
+
+inline void rotate90Rgb565(const uint16_t* src, uint16_t* dst, int32_t w, int32_t h,
+                           int32_t srcStride, int32_t dstStride) {
+#if DISPLAY_ROTATE_KERNEL == ROTATE_KERNEL_PAIRS
+    rotate90Rgb565Pairs(src, dst, w, h, srcStride, dstStride);
+#else
+    rotate90Rgb565Scalar(src, dst, w, h, srcStride, dstStride);
+#endif
+}
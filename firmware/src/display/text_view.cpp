@@ -0,0 +1,144 @@
+#include "text_view.h"
+#include <algorithm>
+#include <cstring>
+
+// Decode the UTF-8 sequence at text[*i] and advance past it. Malformed or
+// truncated sequences come back as U+FFFD, one byte at a time.
+static uint32_t nextCodepoint(const char* text, uint16_t len, uint16_t* i) {
+    uint8_t c = (uint8_t)text[*i];
+    if (c < 0x80) {
+        (*i)++;
+        return c;
+    }
+    uint8_t n = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    if (n == 1 || *i + n > len) {
+        (*i)++;
+        return 0xFFFD;
+    }
+    uint32_t cp = c & (0x7F >> n);
+    for (uint8_t k = 1; k < n; k++) {
+        cp = (cp << 6) | ((uint8_t)text[*i + k] & 0x3F);
+    }
+    *i += n;
+    return cp;
+}
+
+void TextView::create(lv_obj_t* parent, int32_t x, int32_t y, int32_t w, int32_t h,
+                      const lv_font_t* font, lv_color_t color) {
+    _font = font;
+    _width = w;
+    int32_t lineHeight = lv_font_get_line_height(font);
+    int32_t rows = h / lineHeight;
+    _rows = rows < 1 ? 1 : rows > MAX_ROWS ? MAX_ROWS : rows;
+
+    for (uint8_t r = 0; r < _rows; r++) {
+        lv_obj_t* label = lv_label_create(parent);
+        lv_label_set_long_mode(label, LV_LABEL_LONG_CLIP);
+        lv_label_set_text_static(label, _rowText[r]);
+        lv_obj_set_width(label, w);
+        lv_obj_set_pos(label, x, y + r * lineHeight);
+        lv_obj_set_style_text_color(label, color, 0);
+        lv_obj_set_style_text_font(label, font, 0);
+        _rowLabels[r] = label;
+    }
+    _lines = 0;
+    _lineStart[0] = 0;
+}
+
+// Same rules as an LVGL wrapping label: break after the last space that
+// fits, mid-word if a word is wider than the row, and always at '\n'.
+// Returns where the next line starts.
+uint16_t TextView::wrapLine(const char* text, uint16_t len, uint16_t start) const {
+    int32_t width = 0;
+    uint16_t lastBreak = 0;
+    uint16_t i = start;
+    uint16_t next = i;
+    uint32_t cp = i < len ? nextCodepoint(text, len, &next) : 0;
+
+    while (i < len) {
+        if (cp == '\n') return next;
+
+        uint16_t after = next;
+        uint32_t cpNext = next < len ? nextCodepoint(text, len, &after) : 0;
+        int32_t glyph = cp == '\r' ? 0 : lv_font_get_glyph_width(_font, cp, cpNext);
+
+        if (width + glyph > _width && i > start) {
+            if (cp == ' ') return next;  // The space that overflows ends the line
+            return lastBreak > start ? lastBreak : i;
+        }
+        width += glyph;
+        if (cp == ' ') lastBreak = next;
+
+        i = next;
+        next = after;
+        cp = cpNext;
+    }
+    return len;
+}
+
+bool TextView::update(const char* text, uint16_t len, uint16_t from) {
+    if (from > len) from = len;
+
+    // Last line starting at or before the change, then back to the one
+    // before it, and further while lines are pieces of one long word
+    uint16_t line = std::upper_bound(_lineStart, _lineStart + _lines, from) - _lineStart;
+    line = line > 1 ? line - 2 : 0;
+    while (line > 0 && text[_lineStart[line] - 1] != ' ' && text[_lineStart[line] - 1] != '\n') {
+        line--;
+    }
+
+    uint16_t pos = _lines > 0 ? _lineStart[line] : 0;
+    uint16_t n = _lines > 0 ? line : 0;
+    while (pos < len && n < MAX_LINES) {
+        _lineStart[n++] = pos;
+        pos = wrapLine(text, len, pos);
+    }
+    _lineStart[n] = len;
+    _lines = n;
+
+    if (from == 0) _top = 0;
+    uint16_t lastPage = pageCount() - 1;
+    if (_top > lastPage * _rows) _top = lastPage * _rows;
+    return refreshRows(text);
+}
+
+bool TextView::showPage(const char* text, uint16_t page) {
+    uint16_t lastPage = pageCount() - 1;
+    _top = (page < lastPage ? page : lastPage) * _rows;
+    return refreshRows(text);
+}
+
+void TextView::setHidden(bool hidden) {
+    for (uint8_t r = 0; r < _rows; r++) {
+        if (hidden) lv_obj_add_flag(_rowLabels[r], LV_OBJ_FLAG_HIDDEN);
+        else lv_obj_remove_flag(_rowLabels[r], LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+// Copy each visible line into its row and touch only the labels whose text
+// changed; LVGL then invalidates just those rows.
+bool TextView::refreshRows(const char* text) {
+    bool changed = false;
+    for (uint8_t r = 0; r < _rows; r++) {
+        const char* src = "";
+        uint16_t n = 0;
+        uint16_t line = _top + r;
+        if (line < _lines) {
+            src = text + _lineStart[line];
+            n = _lineStart[line + 1] - _lineStart[line];
+            while (n > 0 && (src[n - 1] == '\n' || src[n - 1] == '\r')) n--;
+            if (n > ROW_BYTES - 1) {
+                n = ROW_BYTES - 1;
+                while (n > 0 && ((uint8_t)src[n] & 0xC0) == 0x80) n--;  // Whole characters only
+            }
+        }
+
+        char* row = _rowText[r];
+        if (row[n] == '\0' && memcmp(row, src, n) == 0) continue;
+        memcpy(row, src, n);
+        row[n] = '\0';
+        lv_label_set_text_static(_rowLabels[r], row);
+        changed = true;
+    }
+    return changed;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include "lvgl.h"
+#include "../config.h"
+
+// Word-wrapped view of a text buffer, drawn as one label per visible row.
+//
+// The view keeps the byte offset where each wrapped line starts. When the
+// text changes from some offset onward, only lines from the one before the
+// change are re-measured (a shorter word may now fit on the previous line),
+// and only rows whose text actually differs are handed to LVGL — so an
+// append below the fold costs a few glyph-width lookups and no redraw.
+// Rows hold a copy of their line, so LVGL never reads the caller's buffer.
+//
+// Text longer than the view is paged: page p shows the rows from line
+// p * rows, found directly in the line index, so turning to any page costs
+// the same as redrawing the first one.
+class TextView {
+public:
+    void create(lv_obj_t* parent, int32_t x, int32_t y, int32_t w, int32_t h,
+                const lv_font_t* font, lv_color_t color);
+
+    // text[0, from) is unchanged since the previous call. Needs the LVGL
+    // lock. Returns true if any visible row changed.
+    bool update(const char* text, uint16_t len, uint16_t from);
+
+    uint16_t lineCount() const { return _lines; }
+
+    // Show page (clamped to the last one) of text, the text last passed to
+    // update(). Needs the LVGL lock. Text that changes from its first byte
+    // is a new text and starts again on page 0.
+    bool showPage(const char* text, uint16_t page);
+    uint16_t page() const { return _rows ? _top / _rows : 0; }
+    uint16_t pageCount() const { return _lines > _rows ? (_lines + _rows - 1) / _rows : 1; }
+
+    // Hide the rows while another view covers the area; updates carry on
+    void setHidden(bool hidden);
+
+private:
+    uint16_t wrapLine(const char* text, uint16_t len, uint16_t start) const;
+    bool refreshRows(const char* text);
+
+    static const uint16_t MAX_LINES = NOTIF_TEXT_MAX;  // One byte per line, worst case
+    static const uint8_t  MAX_ROWS = 12;
+    static const uint16_t ROW_BYTES = 256;             // Longer lines are clipped anyway
+
+    const lv_font_t* _font = nullptr;
+    int32_t   _width = 0;
+    uint8_t   _rows = 0;
+    lv_obj_t* _rowLabels[MAX_ROWS] = {};
+    char      _rowText[MAX_ROWS][ROW_BYTES] = {};
+
+    // _lineStart[i] is where line i begins; _lineStart[_lines] is the text length
+    uint16_t  _lineStart[MAX_LINES + 1] = {};
+    uint16_t  _lines = 0;
+    uint16_t  _top = 0;  // First line on screen, a multiple of _rows
+};
@@ -177,11 +177,11 @@
 #define LV_USE_BUTTON     1
 #define LV_USE_BUTTONMATRIX 0
 #define LV_USE_CALENDAR   0
-#define LV_USE_CANVAS     0
+#define LV_USE_CANVAS     1
 #define LV_USE_CHART      0
 #define LV_USE_CHECKBOX   0
 #define LV_USE_DROPDOWN   0
-#define LV_USE_IMAGE      0
+#define LV_USE_IMAGE      1  /* The canvas is an image */
 #define LV_USE_IMAGEBUTTON 0
 #define LV_USE_KEYBOARD   0
 #define LV_USE_LABEL      1
@@ -1,8 +1,11 @@
 #include <Arduino.h>
+#include <esp_timer.h>
 #include "config.h"
 #include "display/display_manager.h"
 #include "seesaw/seesaw_manager.h"
 #include "comms/serial_comms.h"
+#include "storage/asset_store.h"
+#include "util/stats_codec.h"
 
 // With ARDUINO_USB_MODE=1 (HWCDC), Serial = USB-JTAG/Serial.
 // Debug prints are suppressed once the bridge connects (to avoid
@@ -11,15 +14,85 @@
 static DisplayManager display;
 static SeesawManager seesaw;
 static SerialComms comms;
+static AssetStore assets;  // Comms task only
+
+// PSRAM kept for decoded assets (-DASSET_CACHE_KB=...)
+#ifndef ASSET_CACHE_KB
+#define ASSET_CACHE_KB 512
+#endif
+
+// Work runs in two event-driven tasks on the Arduino core instead of a
+// polling loop(): the comms task sleeps until the CDC driver reports
+// received bytes, and the input task is woken by a periodic esp_timer.
+#define COMMS_TASK_STACK_SIZE (8 * 1024)
+#define COMMS_TASK_PRIORITY   3
+#define COMMS_IDLE_WAKE_MS    100  // Wake without RX to run frame/bridge timeouts
+#define INPUT_TASK_STACK_SIZE (4 * 1024)
+#define INPUT_TASK_PRIORITY   4    // Button edges preempt frame parsing
+
+static TaskHandle_t commsTaskHandle = nullptr;
+static TaskHandle_t inputTaskHandle = nullptr;
 
 // Debug print helper — suppressed when bridge is connected
 #define DBG(fmt, ...) do { if (!comms.bridgeConnected()) Serial.printf(fmt "\n", ##__VA_ARGS__); } while(0)
 
 // --- Callbacks ---
 
-static void onButtonChange(uint8_t buttonId, bool pressed) {
+// Once the LVGL task has turned the notification pager, the task that
+// asked is woken and tells the host where it now stands
+static void reportTextPage(DisplayManager::UiLane uiLane, SerialComms::TxLane txLane) {
+    uint16_t page, pages;
+    if (display.takeTextPageReport(uiLane, page, pages)) {
+        comms.sendTextPage(page, pages, txLane);
+    }
+}
+
+#if HISTORY_BUTTON >= 0 || HISTORY_CHORD_FIRST >= 0
+static bool historyOpen = false;  // Input task only
+#endif
+
+#if HISTORY_CHORD_FIRST >= 0
+static void onHistoryChord() {
+    DBG("[btn] history chord");
+    historyOpen = !historyOpen;
+    display.showHistory(historyOpen);
+}
+#endif
+
+static void onButtonChange(uint8_t buttonId, bool pressed, int64_t edgeUs) {
     DBG("[btn] id=%d pressed=%d", buttonId, pressed);
-    comms.sendButtonEvent(buttonId, pressed);
+#if HISTORY_CHORD_FIRST >= 0
+    if (historyOpen && (buttonId == HISTORY_CHORD_FIRST || buttonId == HISTORY_CHORD_SECOND)) {
+        if (pressed) display.scrollHistory(buttonId == HISTORY_CHORD_SECOND ? 1 : -1);  // Second is older
+        return;
+    }
+#endif
+#if HISTORY_BUTTON >= 0
+    if (buttonId == HISTORY_BUTTON) {
+        if (pressed) {
+            historyOpen = !historyOpen;
+            display.showHistory(historyOpen);
+        }
+        return;
+    }
+#endif
+#if PAGER_PREV_BUTTON >= 0 || PAGER_NEXT_BUTTON >= 0
+    if (buttonId == PAGER_PREV_BUTTON || buttonId == PAGER_NEXT_BUTTON) {
+#if HISTORY_BUTTON >= 0
+        if (pressed && historyOpen) {
+            display.scrollHistory(buttonId == PAGER_NEXT_BUTTON ? 1 : -1);  // Next is older
+            return;
+        }
+#endif
+        if (pressed) {
+            display.showTextPage(buttonId == PAGER_NEXT_BUTTON ? DisplayManager::PAGE_NEXT
+                                                               : DisplayManager::PAGE_PREV,
+                                 0, DisplayManager::UI_LANE_INPUT);
+        }
+        return;
+    }
+#endif
+    comms.sendButtonEvent(buttonId, pressed, edgeUs);
 
     // Visual feedback via NeoPixels
     if (pressed) {
@@ -30,35 +103,86 @@ static void onButtonChange(uint8_t buttonId, bool pressed) {
     seesaw.showPixels();
 }
 
-static void onDisplayText(const char* text, uint16_t len) {
-    char buf[512];
-    uint16_t copyLen = len < sizeof(buf) - 1 ? len : sizeof(buf) - 1;
-    memcpy(buf, text, copyLen);
-    buf[copyLen] = '\0';
+static void onDisplayText(const msg::DisplayText& m) {
+    // Straight from the frame buffer into the text arena
+    uint16_t copyLen = m.len < NOTIF_TEXT_MAX ? m.len : NOTIF_TEXT_MAX;
+    memcpy(display.notificationTextSlot(), m.text, copyLen);
+    display.markTextFrame(comms.frameTimeUs());
+    display.commitNotificationText(copyLen);
+    display.update();
+}
+
+// Turn a streaming patch into an edit of the resident text; if it doesn't
+// apply, tell the host where the text stands so it can resync
+static void onTextPatch(const msg::TextPatch& patch) {
+    uint16_t textLen = display.notificationTextLength();
+    uint16_t offset = patch.offset;
+    uint16_t removeLen = patch.count;
+    if (patch.op == protocol::TEXT_OP_APPEND) {
+        offset = textLen;
+        removeLen = 0;
+    } else if (patch.op == protocol::TEXT_OP_TRUNCATE) {
+        removeLen = offset <= textLen ? textLen - offset : 0;
+    }
+
+    display.markTextFrame(comms.frameTimeUs());
+    if (display.editNotificationText(patch.baseRev, offset, removeLen, patch.data, patch.len)) {
+        display.update();
+    } else {
+        comms.sendTextRevision(display.textRevision(), display.notificationTextLength());
+    }
+}
+
+static void onTextPage(const msg::TextPage& m) {
+    DisplayManager::PageOp op = DisplayManager::PAGE_GOTO;
+    if (m.op == protocol::TEXT_PAGE_NEXT) op = DisplayManager::PAGE_NEXT;
+    else if (m.op == protocol::TEXT_PAGE_PREV) op = DisplayManager::PAGE_PREV;
+    display.showTextPage(op, m.page);
+}
 
-    display.setNotificationText(buf);
+static void onImage(const msg::Image& m) {
+    if (m.w == 0) {
+        display.clearImage();
+    } else {
+        DisplayManager::ImageEncoding encoding = m.encoding == protocol::IMAGE_QOI
+            ? DisplayManager::IMAGE_QOI : DisplayManager::IMAGE_RAW;
+        display.drawImage(m.x, m.y, m.w, m.h, m.row, encoding, m.data, m.len);
+    }
     display.update();
 }
 
-static void onStatusText(const char* text, uint16_t len) {
-    char buf[128];
-    uint16_t copyLen = len < sizeof(buf) - 1 ? len : sizeof(buf) - 1;
-    memcpy(buf, text, copyLen);
+static void onAssetShow(const msg::AssetShow& m) {
+    AssetStore::Image image;
+    if (!assets.get(m.hash, image)) {
+        comms.sendAssetMiss(m.hash);
+        return;
+    }
+    if (m.x + image.w > SCREEN_WIDTH || m.y + image.h > SCREEN_HEIGHT) return;
+    display.showImage(m.x, m.y, image.w, image.h, image.pixels);
+    display.update();
+}
+
+static void onAssetPut(const msg::AssetPut& m) {
+    assets.put(m.hash, m.body, m.bodyLen);
+}
+
+static void onStatusText(const msg::StatusText& m) {
+    char buf[STATUS_TEXT_MAX + 1];
+    uint16_t copyLen = m.len < sizeof(buf) - 1 ? m.len : sizeof(buf) - 1;
+    memcpy(buf, m.text, copyLen);
     buf[copyLen] = '\0';
 
     display.setStatusText(buf);
     display.update();
 }
 
-static void onSetLeds(const uint8_t* data, uint16_t len) {
-    for (uint16_t i = 0; i + 3 < len; i += 4) {
-        uint8_t pixel = data[i];
-        uint32_t color = ((uint32_t)data[i+1] << 16) |
-                         ((uint32_t)data[i+2] << 8) |
-                         data[i+3];
-        seesaw.setPixelColor(pixel, color);
+static bool inBatch = false;  // Defer NeoPixel show() to the end of a MSG_BATCH
+
+static void onSetLeds(const msg::SetLeds& m) {
+    for (uint16_t i = 0; i < m.count; i++) {
+        seesaw.setPixelColor(m.pixel(i), m.color(i));
     }
-    seesaw.showPixels();
+    if (!inBatch) seesaw.showPixels();
 }
 
 static void onBridgeDisconnected() {
@@ -66,16 +190,130 @@ static void onBridgeDisconnected() {
     display.update();
 }
 
-static void onClearDisplay() {
+static void onClearDisplay(const msg::Clear&) {
     display.setStatusText("Ready");
     display.setNotificationText("");
     display.setButtonLabels("1", "2", "3", "4");
+    display.clearImage();
+    display.update();
+}
+
+static void onSetButtonLabels(const msg::SetLabels& m) {
+    char bufs[4][BUTTON_LABEL_MAX + 1];
+    for (int i = 0; i < 4; i++) m.labels[i].copyTo(bufs[i], sizeof(bufs[i]));
+    display.setButtonLabels(bufs[0], bufs[1], bufs[2], bufs[3]);
     display.update();
 }
 
-static void onSetButtonLabels(const char* labels[4]) {
-    display.setButtonLabels(labels[0], labels[1], labels[2], labels[3]);
+template <size_t N>
+static uint16_t putCounters(uint8_t* out, const uint32_t (&values)[N]) {
+    for (size_t i = 0; i < N; i++) protocol::putLe32(out + i * 4, values[i]);
+    return N * 4;
+}
+
+// Stats the display keeps; the comms-side ones are answered by SerialComms
+static uint16_t onGetStats(uint8_t statsId, const uint8_t* args, uint16_t argsLen,
+                           uint8_t* out, uint16_t cap) {
+    if (cap < protocol::HISTOGRAM_STATS_LEN) return 0;
+    switch (statsId) {
+    case protocol::STATS_TEXT_LATENCY:
+        return protocol::putHistogram(out, display.textLatency());
+    case protocol::STATS_FRAME_TIME:
+        return protocol::putHistogram(out, display.frameTime());
+    case protocol::STATS_FRAME_PACING: {
+        const DisplayManager::PacingStats& p = display.pacingStats();
+        const uint32_t values[] = {p.vsyncs, p.refreshes, p.missed, p.tears, p.skippedWaits};
+        return putCounters(out, values);
+    }
+    case protocol::STATS_GLYPH_CACHE: {
+        const GlyphCache::Stats& g = display.glyphCacheStats();
+        const uint32_t values[] = {g.hits, g.misses, g.evictions, g.entries, g.bytes};
+        return putCounters(out, values);
+    }
+    case protocol::STATS_UI_QUEUE: {
+        DisplayManager::UiQueueStats q = display.uiQueueStats();
+        const uint32_t values[] = {q.enqueued, q.coalesced, q.fullWaits, q.highWater, q.depth};
+        return putCounters(out, values);
+    }
+    case protocol::STATS_ASSETS: {
+        const AssetStore::Stats& a = assets.stats();
+        const uint32_t values[] = {a.hits, a.loads, a.misses, a.evictions, a.stores,
+                                   a.flashEvictions, a.rejected, a.entries, a.bytes, a.files};
+        return putCounters(out, values);
+    }
+#if DISPLAY_FRAME_PROFILER
+    case protocol::STATS_FRAME_PROFILE: {
+        uint32_t since = argsLen >= 4 ? protocol::getLe32(args) : 0;
+        return protocol::putFrameRecords(out, cap, display.frameProfiler(), since);
+    }
+#endif
+    default:
+        return 0;
+    }
+}
+
+// MSG_BATCH: queue the display changes of all sub-messages together so a
+// prompt's status, text, labels and LEDs appear in the same frame
+static void onBatchBegin() {
+    inBatch = true;
+    display.beginBatch();
+}
+
+static void onBatchEnd() {
+    display.endBatch();
     display.update();
+    seesaw.showPixels();
+    inBatch = false;
+}
+
+// --- Tasks ---
+
+// Runs in the USB CDC event task whenever the driver has queued RX bytes
+static void onSerialRx(void* arg, esp_event_base_t base, int32_t id, void* data) {
+    if (commsTaskHandle) xTaskNotifyGive(commsTaskHandle);
+}
+
+static void commsTask(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(COMMS_IDLE_WAKE_MS));
+        reportTextPage(DisplayManager::UI_LANE_COMMS, SerialComms::TX_LANE_BULK);
+        comms.poll();
+    }
+}
+
+static void onInputTimer(void* arg) {
+    xTaskNotifyGive(inputTaskHandle);
+}
+
+static void inputTask(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+#if PAGER_PREV_BUTTON >= 0 || PAGER_NEXT_BUTTON >= 0
+        reportTextPage(DisplayManager::UI_LANE_INPUT, SerialComms::TX_LANE_HIGH);
+#endif
+        seesaw.poll();
+    }
+}
+
+static void startTasks() {
+    xTaskCreatePinnedToCore(inputTask, "input", INPUT_TASK_STACK_SIZE, NULL,
+                            INPUT_TASK_PRIORITY, &inputTaskHandle, ARDUINO_RUNNING_CORE);
+    xTaskCreatePinnedToCore(commsTask, "comms", COMMS_TASK_STACK_SIZE, NULL,
+                            COMMS_TASK_PRIORITY, &commsTaskHandle, ARDUINO_RUNNING_CORE);
+
+#if ARDUINO_USB_MODE
+    Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, onSerialRx);
+#else
+    Serial.onEvent(ARDUINO_USB_CDC_RX_EVENT, onSerialRx);
+#endif
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = &onInputTimer,
+        .name = "input_poll"
+    };
+    esp_timer_handle_t input_timer = NULL;
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &input_timer));
+    ESP_ERROR_CHECK(esp_timer_start_periodic(input_timer, INPUT_POLL_PERIOD_MS * 1000));
 }
 
 void setup() {
@@ -85,19 +323,19 @@ void setup() {
     // Setup debug prints always go through (bridge can't be connected yet)
     Serial.println("\n=== CamelPad Firmware Starting ===");
 
-    Serial.println("[1/3] Initializing display...");
+    Serial.println("[1/4] Initializing display...");
     display.begin();
     display.setStatusText("Booting...");
     display.update();
-    Serial.println("[1/3] Display OK");
+    Serial.println("[1/4] Display OK");
 
-    Serial.println("[2/3] Initializing Seesaw...");
+    Serial.println("[2/4] Initializing Seesaw...");
     if (!seesaw.begin()) {
-        Serial.println("[2/3] Seesaw init FAILED!");
+        Serial.println("[2/4] Seesaw init FAILED!");
         display.setStatusText("Seesaw init FAILED");
         display.update();
     } else {
-        Serial.println("[2/3] Seesaw OK");
+        Serial.println("[2/4] Seesaw OK");
         for (int i = 0; i < SEESAW_NEOPIXEL_COUNT; i++) {
             seesaw.setPixelColor(i, 0x001100);
         }
@@ -106,36 +344,47 @@ void setup() {
     }
 
     seesaw.onButtonChange(onButtonChange);
+#if HISTORY_CHORD_FIRST >= 0
+    seesaw.onChord(HISTORY_CHORD_FIRST, HISTORY_CHORD_SECOND, onHistoryChord);
+#endif
 
-    Serial.println("[3/3] Initializing comms...");
+    Serial.println("[3/4] Mounting asset store...");
+    if (!assets.begin(ASSET_CACHE_KB * 1024)) {
+        Serial.println("[3/4] Asset store unavailable; assets will be resent");
+    } else {
+        Serial.printf("[3/4] Asset store OK (%u assets)\n", (unsigned)assets.stats().files);
+    }
+
+    Serial.println("[4/4] Initializing comms...");
     comms.begin();
-    comms.onDisplayText(onDisplayText);
-    comms.onStatusText(onStatusText);
-    comms.onSetLeds(onSetLeds);
-    comms.onClearDisplay(onClearDisplay);
-    comms.onSetButtonLabels(onSetButtonLabels);
+    comms.on(onDisplayText);
+    comms.on(onTextPatch);
+    comms.on(onTextPage);
+    comms.on(onImage);
+    comms.on(onAssetShow);
+    comms.on(onAssetPut);
+    comms.on(onStatusText);
+    comms.on(onSetLeds);
+    comms.on(onClearDisplay);
+    comms.on(onSetButtonLabels);
     comms.onBridgeDisconnected(onBridgeDisconnected);
-    Serial.println("[3/3] Comms OK");
+    comms.onBatchBegin(onBatchBegin);
+    comms.onBatchEnd(onBatchEnd);
+    comms.onGetStats(onGetStats);
+    Serial.println("[4/4] Comms OK");
 
     seesaw.clearPixels();
     seesaw.showPixels();
 
     display.setStatusText("Ready - Waiting for connection...");
     display.update();
+
+    startTasks();
     Serial.println("=== Setup Complete ===");
 }
 
-static uint32_t lastHeartbeat = 0;
-
 void loop() {
-    comms.poll();
-    seesaw.poll();
-
     // Periodic heartbeat — suppressed when bridge is connected
-    if (millis() - lastHeartbeat > 5000) {
-        lastHeartbeat = millis();
-        DBG("[heartbeat] uptime=%lus", millis() / 1000);
-    }
-
-    delay(10);
+    DBG("[heartbeat] uptime=%lus", millis() / 1000);
+    vTaskDelay(pdMS_TO_TICKS(5000));
 }
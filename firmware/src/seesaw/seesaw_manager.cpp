@@ -1,9 +1,11 @@
 #include "seesaw_manager.h"
 #include <Wire.h>
+#include <esp_timer.h>
 
 constexpr uint8_t SeesawManager::BUTTON_PINS[4];
 
 bool SeesawManager::begin() {
+    _i2cMux = xSemaphoreCreateMutex();
     Wire.begin(PIN_I2C_SDA, PIN_I2C_SCL);
 
     // Single begin() — handles reset, NeoPixel init, and I2C setup
@@ -36,7 +38,10 @@ void SeesawManager::poll() {
         // Skip if within debounce window
         if (now - _lastChangeTime[i] < DEBOUNCE_MS) continue;
 
+        xSemaphoreTake(_i2cMux, portMAX_DELAY);
+        int64_t sampled = esp_timer_get_time();
         bool raw = _pixels.digitalRead(BUTTON_PINS[i]);
+        xSemaphoreGive(_i2cMux);
         bool pressed = _activeLow[i] ? !raw : raw;
 
         if (pressed == _lastButtonState[i]) {
@@ -46,17 +51,54 @@ void SeesawManager::poll() {
             // Raw state changed — reset counter
             _lastButtonState[i] = pressed;
             _stableCount[i] = 1;
+            _edgeTime[i] = sampled;
         }
 
         // Only report when we have enough consistent reads AND it differs from reported state
         if (_stableCount[i] >= DEBOUNCE_READS && pressed != _reportedState[i]) {
             _reportedState[i] = pressed;
             _lastChangeTime[i] = now;
-            if (_callback) {
-                _callback(i, pressed);
-            }
+            report(i, pressed, _edgeTime[i], now);
         }
     }
+
+    // A held-back press whose chord partner didn't follow goes out late
+    for (int i = 0; i < 4; i++) {
+        if (_chordHeld[i] && now - _chordHeldSince[i] >= CHORD_WINDOW_MS) {
+            _chordHeld[i] = false;
+            if (_callback) _callback(i, true, _chordHeldEdge[i]);
+        }
+    }
+}
+
+// A debounced change, through chord detection when the button is part of
+// the chord. A partner already reported pressed is too late for a chord.
+void SeesawManager::report(uint8_t button, bool pressed, int64_t edgeUs, uint32_t now) {
+    int partner = button == _chord[0] ? _chord[1] : button == _chord[1] ? _chord[0] : -1;
+    if (partner >= 0 && _chordCallback) {
+        if (_chordActive) {
+            if (!_reportedState[_chord[0]] && !_reportedState[_chord[1]]) _chordActive = false;
+            return;
+        }
+        if (pressed && _chordHeld[partner]) {
+            _chordHeld[partner] = false;
+            _chordActive = true;
+            _chordCallback();
+            return;
+        }
+        if (pressed && !_reportedState[partner]) {
+            _chordHeld[button] = true;
+            _chordHeldSince[button] = now;
+            _chordHeldEdge[button] = edgeUs;
+            return;
+        }
+        if (!pressed && _chordHeld[button]) {
+            // Released within the window: the press it held goes first
+            _chordHeld[button] = false;
+            if (_callback) _callback(button, true, _chordHeldEdge[button]);
+        }
+    }
+    if (_callback) _callback(button, pressed, edgeUs);
 }
 
 bool SeesawManager::isButtonPressed(uint8_t btnIndex) {
@@ -67,16 +109,22 @@ bool SeesawManager::isButtonPressed(uint8_t btnIndex) {
 
 void SeesawManager::setPixelColor(uint8_t pixel, uint32_t color) {
     if (pixel < SEESAW_NEOPIXEL_COUNT) {
+        xSemaphoreTake(_i2cMux, portMAX_DELAY);
         _pixels.setPixelColor(pixel, color);
+        xSemaphoreGive(_i2cMux);
     }
 }
 
 void SeesawManager::clearPixels() {
+    xSemaphoreTake(_i2cMux, portMAX_DELAY);
     for (int i = 0; i < SEESAW_NEOPIXEL_COUNT; i++) {
         _pixels.setPixelColor(i, 0);
     }
+    xSemaphoreGive(_i2cMux);
 }
 
 void SeesawManager::showPixels() {
+    xSemaphoreTake(_i2cMux, portMAX_DELAY);
     _pixels.show();
+    xSemaphoreGive(_i2cMux);
 }
@@ -2,11 +2,16 @@
 
 #include <Adafruit_seesaw.h>
 #include <seesaw_neopixel.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "../config.h"
 
 class SeesawManager {
 public:
-    using ButtonCallback = void (*)(uint8_t buttonId, bool pressed);
+    // edgeUs is esp_timer_get_time() at the first raw read that showed the
+    // new state, i.e. before debouncing
+    using ButtonCallback = void (*)(uint8_t buttonId, bool pressed, int64_t edgeUs);
+    using ChordCallback = void (*)();
 
     bool begin();
     void poll();
@@ -16,9 +21,27 @@ public:
     void showPixels();
     void onButtonChange(ButtonCallback cb) { _callback = cb; }
 
+    // Buttons a and b pressed within CHORD_WINDOW_MS of each other call cb
+    // once, and neither those presses nor the releases that follow reach
+    // onButtonChange. A press of either is held back for the window in
+    // case the other follows, then reported with its original edge time.
+    void onChord(uint8_t a, uint8_t b, ChordCallback cb) {
+        _chord[0] = a;
+        _chord[1] = b;
+        _chordCallback = cb;
+    }
+
 private:
+    // Buttons are polled from the input task while LEDs are also driven
+    // from the comms task; every I2C transaction and the pixel buffer are
+    // guarded by _i2cMux. Button callbacks run with it released.
+    SemaphoreHandle_t _i2cMux = nullptr;
+
     static constexpr uint32_t DEBOUNCE_MS = 50;
     static constexpr uint8_t  DEBOUNCE_READS = 3;  // Require N consistent reads
+    static constexpr uint32_t CHORD_WINDOW_MS = 80;
+
+    void report(uint8_t button, bool pressed, int64_t edgeUs, uint32_t now);
 
     // Single seesaw instance for both GPIO and NeoPixels
     // (seesaw_NeoPixel inherits Adafruit_seesaw, so it has pinMode/digitalRead)
@@ -34,5 +57,13 @@ private:
     bool _reportedState[4] = {};      // State reported to callback
     uint8_t _stableCount[4] = {};     // Consecutive reads matching _lastButtonState
     uint32_t _lastChangeTime[4] = {};
+    int64_t _edgeTime[4] = {};        // When _lastButtonState last changed
     ButtonCallback _callback = nullptr;
+
+    int8_t _chord[2] = {-1, -1};
+    bool _chordHeld[4] = {};          // Press held back, waiting for the other chord button
+    uint32_t _chordHeldSince[4] = {};
+    int64_t _chordHeldEdge[4] = {};
+    bool _chordActive = false;        // Chord reported; its buttons are swallowed until both are up
+    ChordCallback _chordCallback = nullptr;
 };
@@ -0,0 +1,247 @@
+#include "asset_store.h"
+#include <LittleFS.h>
+#include <cstring>
+#include <esp_heap_caps.h>
+#include "mbedtls/sha256.h"
+#include "../config.h"
+#include "../comms/protocol.h"
+#include "../display/image_decoder.h"
+
+#define ASSET_PARTITION "assets"
+#define ASSET_TMP_PATH  "/.partial"  // Written, then renamed to the hash
+
+static const uint8_t BODY_HEADER_LEN = 5;  // w(2), h(2), encoding
+
+static bool hashMatches(const uint8_t* hash, const uint8_t* body, uint32_t len) {
+    uint8_t digest[32];
+    if (mbedtls_sha256(body, len, digest, 0) != 0) return false;
+    return memcmp(digest, hash, AssetStore::HASH_LEN) == 0;
+}
+
+bool AssetStore::begin(uint32_t cacheBytes) {
+    _budget = cacheBytes;
+    _files = (FileEntry*)heap_caps_calloc(MAX_FILES, sizeof(FileEntry), MALLOC_CAP_SPIRAM);
+    _scratch = (uint8_t*)heap_caps_malloc(MAX_REASSEMBLED_LEN, MALLOC_CAP_SPIRAM);
+    if (!_files || !_scratch) return false;
+    if (!LittleFS.begin(true, "/" ASSET_PARTITION, 4, ASSET_PARTITION)) return false;
+
+    File root = LittleFS.open("/");
+    if (!root) return false;
+    for (File f = root.openNextFile(); f && _fileCount < MAX_FILES; f = root.openNextFile()) {
+        FileEntry& e = _files[_fileCount];
+        if (f.isDirectory() || !hashOf(f.name(), e.hash)) continue;
+        e.size = f.size();
+        e.lastUse = 0;
+        _fileCount++;
+    }
+    _stats.files = _fileCount;
+    return true;
+}
+
+bool AssetStore::put(const uint8_t* hash, const uint8_t* body, uint16_t bodyLen) {
+    if (!_files) return false;
+    if (findDecoded(hash) >= 0) return true;
+    if (!hashMatches(hash, body, bodyLen)) {
+        _stats.rejected++;
+        return false;
+    }
+    Image image;
+    if (!decode(hash, body, bodyLen, image)) {
+        _stats.rejected++;
+        return false;
+    }
+    // Held decoded even if it can't be written; it is then lost on eviction
+    if (findFile(hash) < 0) writeFile(hash, body, bodyLen);
+    return true;
+}
+
+bool AssetStore::get(const uint8_t* hash, Image& out) {
+    int d = findDecoded(hash);
+    int f = findFile(hash);
+    if (f >= 0) _files[f].lastUse = ++_tick;
+    if (d >= 0) {
+        Decoded& e = _decoded[d];
+        e.lastUse = ++_tick;
+        out = {e.pixels, e.w, e.h};
+        _stats.hits++;
+        return true;
+    }
+
+    uint32_t len;
+    if (f < 0 || !readFile(f, len)) {
+        _stats.misses++;
+        return false;
+    }
+    if (!hashMatches(hash, _scratch, len) || !decode(hash, _scratch, len, out)) {
+        // Corrupt on flash, or no longer fits the budget: have it sent again
+        removeFile(f);
+        _stats.rejected++;
+        _stats.misses++;
+        return false;
+    }
+    _stats.loads++;
+    return true;
+}
+
+// Into a new PSRAM buffer, evicting the least recently used decoded
+// assets to make room
+bool AssetStore::decode(const uint8_t* hash, const uint8_t* body, uint32_t len, Image& out) {
+    if (len < BODY_HEADER_LEN) return false;
+    uint16_t w = (uint16_t)(body[0] << 8 | body[1]);
+    uint16_t h = (uint16_t)(body[2] << 8 | body[3]);
+    uint8_t encoding = body[4];
+    uint32_t size = (uint32_t)w * h * 2;
+    if (w == 0 || h == 0 || encoding > protocol::IMAGE_QOI || size > _budget) return false;
+
+    int slot = -1;
+    for (;;) {
+        for (uint8_t i = 0; i < MAX_DECODED && slot < 0; i++) {
+            if (!_decoded[i].pixels) slot = i;
+        }
+        if (slot >= 0 && _stats.bytes + size <= _budget) break;
+        if (!evictDecoded()) return false;
+        slot = -1;
+    }
+
+    uint16_t* pixels = (uint16_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!pixels) return false;
+    const uint8_t* data = body + BODY_HEADER_LEN;
+    uint32_t dataLen = len - BODY_HEADER_LEN;
+    uint16_t rows = encoding == protocol::IMAGE_QOI ? image::decodeQoi(data, dataLen, pixels, w, h)
+                                                    : image::decodeRaw(data, dataLen, pixels, w, h);
+    if (rows != h) {
+        heap_caps_free(pixels);
+        return false;
+    }
+
+    Decoded& e = _decoded[slot];
+    memcpy(e.hash, hash, HASH_LEN);
+    e.pixels = pixels;
+    e.w = w;
+    e.h = h;
+    e.lastUse = ++_tick;
+    _stats.entries++;
+    _stats.bytes += size;
+    out = {pixels, w, h};
+    return true;
+}
+
+// Returns false if nothing is decoded
+bool AssetStore::evictDecoded() {
+    int oldest = -1;
+    for (uint8_t i = 0; i < MAX_DECODED; i++) {
+        if (_decoded[i].pixels &&
+            (oldest < 0 || _decoded[i].lastUse < _decoded[oldest].lastUse)) {
+            oldest = i;
+        }
+    }
+    if (oldest < 0) return false;
+    Decoded& e = _decoded[oldest];
+    heap_caps_free(e.pixels);
+    e.pixels = nullptr;
+    _stats.entries--;
+    _stats.bytes -= (uint32_t)e.w * e.h * 2;
+    _stats.evictions++;
+    return true;
+}
+
+// Written under a temporary name and renamed, so a reset part way through
+// never leaves a truncated file under a hash
+bool AssetStore::writeFile(const uint8_t* hash, const uint8_t* body, uint16_t len) {
+    if (_fileCount == MAX_FILES) {
+        removeFile(oldestFile());
+        _stats.flashEvictions++;
+    }
+    while (LittleFS.totalBytes() - LittleFS.usedBytes() < len + FLASH_RESERVE) {
+        if (_fileCount == 0) return false;
+        removeFile(oldestFile());
+        _stats.flashEvictions++;
+    }
+
+    char path[PATH_LEN];
+    pathOf(hash, path);
+    File f = LittleFS.open(ASSET_TMP_PATH, "w");
+    bool written = f && f.write(body, len) == len;
+    if (f) f.close();
+    if (!written || !LittleFS.rename(ASSET_TMP_PATH, path)) {
+        LittleFS.remove(ASSET_TMP_PATH);
+        return false;
+    }
+
+    FileEntry& e = _files[_fileCount++];
+    memcpy(e.hash, hash, HASH_LEN);
+    e.size = len;
+    e.lastUse = ++_tick;
+    _stats.stores++;
+    _stats.files = _fileCount;
+    return true;
+}
+
+// Into _scratch
+bool AssetStore::readFile(uint16_t i, uint32_t& len) {
+    if (_files[i].size > MAX_REASSEMBLED_LEN) return false;
+    char path[PATH_LEN];
+    pathOf(_files[i].hash, path);
+    File f = LittleFS.open(path, "r");
+    if (!f) return false;
+    len = f.read(_scratch, _files[i].size);
+    f.close();
+    return len == _files[i].size;
+}
+
+void AssetStore::removeFile(uint16_t i) {
+    char path[PATH_LEN];
+    pathOf(_files[i].hash, path);
+    LittleFS.remove(path);
+    _files[i] = _files[--_fileCount];
+    _stats.files = _fileCount;
+}
+
+uint16_t AssetStore::oldestFile() const {
+    uint16_t oldest = 0;
+    for (uint16_t i = 1; i < _fileCount; i++) {
+        if (_files[i].lastUse < _files[oldest].lastUse) oldest = i;
+    }
+    return oldest;
+}
+
+int AssetStore::findFile(const uint8_t* hash) const {
+    for (uint16_t i = 0; i < _fileCount; i++) {
+        if (memcmp(_files[i].hash, hash, HASH_LEN) == 0) return i;
+    }
+    return -1;
+}
+
+int AssetStore::findDecoded(const uint8_t* hash) const {
+    for (uint8_t i = 0; i < MAX_DECODED; i++) {
+        if (_decoded[i].pixels && memcmp(_decoded[i].hash, hash, HASH_LEN) == 0) return i;
+    }
+    return -1;
+}
+
+// "/" and the hash in lowercase hex
+void AssetStore::pathOf(const uint8_t* hash, char* path) {
+    static const char hex[] = "0123456789abcdef";
+    path[0] = '/';
+    for (uint8_t i = 0; i < HASH_LEN; i++) {
+        path[1 + 2 * i] = hex[hash[i] >> 4];
+        path[2 + 2 * i] = hex[hash[i] & 0xF];
+    }
+    path[PATH_LEN - 1] = '\0';
+}
+
+// Names that aren't a hash (an interrupted write) are skipped
+bool AssetStore::hashOf(const char* name, uint8_t* hash) {
+    if (name[0] == '/') name++;
+    if (strlen(name) != 2 * HASH_LEN) return false;
+    for (uint8_t i = 0; i < 2 * HASH_LEN; i++) {
+        char c = name[i];
+        uint8_t nibble;
+        if (c >= '0' && c <= '9') nibble = c - '0';
+        else if (c >= 'a' && c <= 'f') nibble = c - 'a' + 10;
+        else return false;
+        if (i % 2 == 0) hash[i / 2] = nibble << 4;
+        else hash[i / 2] |= nibble;
+    }
+    return true;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+
+// Content-addressed images (see protocol::ASSET_*) kept on the "assets"
+// LittleFS partition, one file per hash holding the bytes it was hashed
+// over, and checked against its name whenever it is read back. The most
+// recently used assets are also kept decoded to RGB565 in PSRAM, up to a
+// byte budget, so showing one again costs a copy.
+//
+// When the partition fills up, the files used least recently since boot
+// are deleted first; files not used since boot go before any that were,
+// in no particular order among themselves.
+//
+// Comms task only. A put blocks it for the few milliseconds writing the
+// file to flash takes.
+class AssetStore {
+public:
+    static const uint8_t HASH_LEN = 16;  // protocol::ASSET_HASH_LEN
+
+    struct Stats {
+        uint32_t hits;            // Found decoded in PSRAM
+        uint32_t loads;           // Read back from flash and decoded
+        uint32_t misses;          // Not held
+        uint32_t evictions;       // Decoded assets dropped for the PSRAM budget
+        uint32_t stores;          // Files written
+        uint32_t flashEvictions;  // Files deleted to make room
+        uint32_t rejected;        // Hash mismatch or undecodable, put or read back
+        uint32_t entries;         // Decoded now
+        uint32_t bytes;           // ...and the PSRAM they take
+        uint32_t files;           // On flash now
+    };
+
+    // A decoded asset; valid until the next get() or put()
+    struct Image {
+        const uint16_t* pixels;
+        uint16_t        w;
+        uint16_t        h;
+    };
+
+    // Mounts the partition, formatting it if it won't mount, and indexes
+    // the files on it. Without it every get() misses.
+    bool begin(uint32_t cacheBytes);
+
+    // body is [w(2), h(2), encoding, data]; it is stored only if it matches
+    // hash and decodes to a whole image no bigger than the PSRAM budget.
+    // Returns whether the asset is held.
+    bool put(const uint8_t* hash, const uint8_t* body, uint16_t bodyLen);
+    bool get(const uint8_t* hash, Image& out);
+
+    const Stats& stats() const { return _stats; }
+
+private:
+    struct FileEntry {
+        uint8_t  hash[HASH_LEN];
+        uint32_t size;
+        uint32_t lastUse;  // 0 if not used since boot
+    };
+
+    struct Decoded {
+        uint8_t   hash[HASH_LEN];
+        uint16_t* pixels;  // PSRAM; nullptr when the slot is free
+        uint16_t  w;
+        uint16_t  h;
+        uint32_t  lastUse;
+    };
+
+    bool decode(const uint8_t* hash, const uint8_t* body, uint32_t len, Image& out);
+    bool writeFile(const uint8_t* hash, const uint8_t* body, uint16_t len);
+    bool readFile(uint16_t i, uint32_t& len);
+    void removeFile(uint16_t i);
+    uint16_t oldestFile() const;
+    bool evictDecoded();
+    int findFile(const uint8_t* hash) const;
+    int findDecoded(const uint8_t* hash) const;
+    static void pathOf(const uint8_t* hash, char* path);
+    static bool hashOf(const char* name, uint8_t* hash);
+
+    static const uint16_t MAX_FILES = 256;
+    static const uint8_t  MAX_DECODED = 32;
+    static const uint32_t FLASH_RESERVE = 2 * 4096;  // Blocks for metadata and the rename
+    static const uint8_t  PATH_LEN = 2 + 2 * HASH_LEN;
+
+    FileEntry* _files = nullptr;    // PSRAM
+    uint16_t   _fileCount = 0;
+    Decoded    _decoded[MAX_DECODED] = {};
+    uint8_t*   _scratch = nullptr;  // A file read back; PSRAM
+    uint32_t   _budget = 0;
+    uint32_t   _tick = 0;
+    Stats      _stats = {};
+};
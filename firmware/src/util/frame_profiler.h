@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Per-frame timing of the LVGL pipeline, built in with
+// -DDISPLAY_FRAME_PROFILER=1. Without it the hooks in display_manager.cpp
+// compile to nothing.
+#ifndef DISPLAY_FRAME_PROFILER
+#define DISPLAY_FRAME_PROFILER 0
+#endif
+
+// One LVGL refresh that flushed something. Times are microseconds.
+struct FrameRecord {
+    uint32_t seq;           // Counts up from 0 with every recorded frame
+    uint32_t startUs;       // Low 32 bits of esp_timer_get_time() at refresh start
+    uint32_t totalUs;
+    uint32_t renderUs;      // totalUs minus rotate, draw_bitmap and flush wait
+    uint32_t rotateUs;      // In strip mode the worker's time, overlapping render
+    uint32_t drawBitmapUs;
+    uint32_t flushWaitUs;
+    uint32_t lockWaitUs;    // lvgl_task waiting for the LVGL lock before the refresh
+    uint32_t areaPx;
+    uint16_t areas;         // Flushed areas
+};
+
+// The last RECORDS frames. One writer, the LVGL task; readers on other
+// tasks take no lock. commit() publishes a record by advancing nextSeq()
+// once it is written, and read() copies one out and then checks that
+// commit() hadn't started overwriting it meanwhile.
+class FrameProfiler {
+public:
+    static const uint8_t RECORDS = 64;
+
+    FrameRecord& current() { return _current; }
+
+    void begin(uint32_t startUs, uint32_t lockWaitUs) {
+        _current = {};
+        _current.startUs = startUs;
+        _current.lockWaitUs = lockWaitUs;
+    }
+
+    void commit(uint32_t totalUs) {
+        FrameRecord& r = _current;
+        uint32_t accounted = r.rotateUs + r.drawBitmapUs + r.flushWaitUs;
+        uint32_t seq = _next.load(std::memory_order_relaxed);
+        r.seq = seq;
+        r.totalUs = totalUs;
+        r.renderUs = totalUs > accounted ? totalUs - accounted : 0;
+        _writing.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _ring[seq % RECORDS] = r;
+        _next.store(seq + 1, std::memory_order_release);
+    }
+
+    // Oldest seq still held, and the one the next frame will get
+    uint32_t firstSeq() const {
+        uint32_t next = nextSeq();
+        return next > RECORDS ? next - RECORDS : 0;
+    }
+    uint32_t nextSeq() const { return _next.load(std::memory_order_acquire); }
+
+    // False if seq isn't held: not committed yet, or overwritten before
+    // or while it was copied
+    bool read(uint32_t seq, FrameRecord& out) const {
+        if (seq >= nextSeq()) return false;
+        out = _ring[seq % RECORDS];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return _writing.load(std::memory_order_relaxed) <= seq + RECORDS;
+    }
+
+private:
+    FrameRecord           _ring[RECORDS] = {};
+    FrameRecord           _current = {};
+    std::atomic<uint32_t> _next{0};
+    std::atomic<uint32_t> _writing{0};  // One past the seq commit() is writing
+};
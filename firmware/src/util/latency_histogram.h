@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Latency histogram with power-of-two buckets in microseconds: bucket 0
+// counts 0 µs, bucket b counts [2^(b-1), 2^b). Recording is a few
+// instructions and the memory is fixed, so it can stay on in production
+// builds. Single writer; readers may see a sample half-recorded, which
+// only matters for an exact count.
+class LatencyHistogram {
+public:
+    static const uint8_t BUCKETS = 24;  // The last one, from ~4 s, also takes anything longer
+
+    void record(uint32_t us) {
+        uint8_t b = us == 0 ? 0 : 32 - __builtin_clz(us);
+        if (b >= BUCKETS) b = BUCKETS - 1;
+        _buckets[b]++;
+        _count++;
+        if (us > _max) _max = us;
+    }
+
+    // Upper edge of the bucket holding the p-th percentile, capped at the
+    // largest sample seen: within a factor of two of the exact value.
+    uint32_t percentile(uint8_t p) const {
+        if (_count == 0) return 0;
+        uint64_t rank = ((uint64_t)_count * p + 99) / 100;
+        uint32_t seen = 0;
+        for (uint8_t b = 0; b < BUCKETS; b++) {
+            seen += _buckets[b];
+            if (seen >= rank) {
+                uint32_t edge = b == 0 ? 0 : (1u << b) - 1;
+                return edge < _max ? edge : _max;
+            }
+        }
+        return _max;
+    }
+
+    uint32_t count() const { return _count; }
+    uint32_t max() const { return _max; }
+    uint32_t bucket(uint8_t b) const { return _buckets[b]; }
+
+private:
+    uint32_t _buckets[BUCKETS] = {};
+    uint32_t _count = 0;
+    uint32_t _max = 0;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-capacity single-producer/single-consumer queue of preallocated
+// slots. Neither side locks or allocates: the producer fills a slot in
+// place and publishes it, the consumer reads it in place and releases it.
+// Exactly one task may call the producer methods and one the consumer
+// methods; N must be a power of two.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    // --- Producer ---
+
+    // Next free slot, or nullptr when the ring is full. Not visible to the
+    // consumer until publish().
+    T* acquire() {
+        uint32_t tail = _tail.load(std::memory_order_relaxed) + _staged;
+        if (tail - _head.load(std::memory_order_acquire) == N) return nullptr;
+        return &_slots[tail & (N - 1)];
+    }
+
+    void publish() {
+        _staged++;
+        publishStaged();
+    }
+
+    // Hold the acquired slot back instead: staged slots become visible
+    // together, at the next publish() or publishStaged()
+    void stage() { _staged++; }
+
+    void publishStaged() {
+        _tail.store(_tail.load(std::memory_order_relaxed) + _staged, std::memory_order_release);
+        _staged = 0;
+    }
+
+    uint32_t staged() const { return _staged; }
+
+    // --- Consumer ---
+
+    // Oldest published slot, or nullptr when the ring is empty.
+    T* peek() {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) return nullptr;
+        return &_slots[head & (N - 1)];
+    }
+
+    void pop() {
+        _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // --- Either side (a snapshot) ---
+
+    size_t size() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t capacity() { return N; }
+
+private:
+    T _slots[N];
+    std::atomic<uint32_t> _head{0};  // Written by the consumer only
+    std::atomic<uint32_t> _tail{0};  // Written by the producer only
+    uint32_t _staged = 0;            // Producer only
+};
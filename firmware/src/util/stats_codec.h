@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include "../comms/protocol.h"
+#include "latency_histogram.h"
+#include "frame_profiler.h"
+
+// MSG_STATS payloads for the stats the firmware keeps in util/, kept out
+// of protocol.h so the framing code doesn't depend on them.
+namespace protocol {
+
+// Latency stats payload: count, p50, p90, p99, max, then every bucket
+// count, all little-endian u32s in microseconds. Returns bytes written.
+static constexpr uint16_t HISTOGRAM_STATS_LEN = (5 + LatencyHistogram::BUCKETS) * 4;
+
+inline uint16_t putHistogram(uint8_t* p, const LatencyHistogram& h) {
+    const uint32_t summary[] = {h.count(), h.percentile(50), h.percentile(90),
+                                h.percentile(99), h.max()};
+    uint16_t pos = 0;
+    for (uint32_t v : summary) {
+        putLe32(p + pos, v);
+        pos += 4;
+    }
+    for (uint8_t b = 0; b < LatencyHistogram::BUCKETS; b++) {
+        putLe32(p + pos, h.bucket(b));
+        pos += 4;
+    }
+    return pos;
+}
+
+// Frame profile payload, for MSG_GET_STATS [STATS_FRAME_PROFILE, since(4)]:
+//   [first_seq(4), next_seq(4), count] then count records, oldest first,
+// each the FrameRecord fields in order (u32 LE, areas u16 LE). Records
+// start at since, or at the oldest one held if since has been overwritten
+// (first_seq > since shows the gap); ask again from first_seq + count for
+// more. Returns bytes written.
+static constexpr uint16_t FRAME_PROFILE_HEADER_LEN = 9;
+static constexpr uint16_t FRAME_RECORD_LEN = 9 * 4 + 2;
+
+inline uint16_t putFrameRecords(uint8_t* p, uint16_t cap, const FrameProfiler& prof,
+                                uint32_t since) {
+    if (cap < FRAME_PROFILE_HEADER_LEN) return 0;
+    uint32_t first = since > prof.firstSeq() ? since : prof.firstSeq();
+    uint32_t next = prof.nextSeq();
+    uint32_t fits = (cap - FRAME_PROFILE_HEADER_LEN) / FRAME_RECORD_LEN;
+    uint8_t count = 0;
+    uint16_t pos = FRAME_PROFILE_HEADER_LEN;
+    for (uint32_t seq = first; seq < next && count < fits; seq++) {
+        FrameRecord r;
+        if (!prof.read(seq, r)) {
+            // Overwritten by a frame committed since; the gap shows in first_seq
+            first = seq + 1;
+            continue;
+        }
+        const uint32_t values[] = {r.seq, r.startUs, r.totalUs, r.renderUs, r.rotateUs,
+                                   r.drawBitmapUs, r.flushWaitUs, r.lockWaitUs, r.areaPx};
+        for (uint32_t v : values) {
+            putLe32(p + pos, v);
+            pos += 4;
+        }
+        p[pos++] = (uint8_t)(r.areas & 0xFF);
+        p[pos++] = (uint8_t)(r.areas >> 8);
+        count++;
+    }
+
+    putLe32(p, first);
+    putLe32(p + 4, next);
+    p[8] = count;
+    return pos;
+}
+
+} // namespace protocol
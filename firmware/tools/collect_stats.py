@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Collect latency and frame-time histograms from a CamelPad over USB serial.
+
+Sends notification texts at a steady rate and reads the device's
+STATS_TEXT_LATENCY, STATS_FRAME_TIME and STATS_BUTTON_LATENCY histograms
+(see protocol.h) before and after. The figures printed are for the
+samples recorded in between, so anything the device did before the run
+doesn't count. Press buttons during the run for button latency samples.
+
+The bridge must not be holding the port. Frames are v1 (0xAA, XOR), which
+every firmware speaks without a MSG_HELLO.
+
+    uv run tools/collect_stats.py /dev/cu.usbmodem101 --texts 200 --interval 100
+    uv run tools/collect_stats.py /dev/ttyACM0 --json run.json
+"""
+
+import argparse
+import json
+import struct
+import sys
+import time
+
+import serial
+
+MSG_DISPLAY_TEXT = 0x01
+MSG_GET_STATS = 0x0D
+MSG_STATS = 0x0E
+
+STATS_LINK = 0
+STATS_TEXT_LATENCY = 1
+STATS_BUTTON_LATENCY = 2
+STATS_FRAME_TIME = 3
+
+HISTOGRAMS = {
+    "text_latency": STATS_TEXT_LATENCY,
+    "frame_time": STATS_FRAME_TIME,
+    "button_latency": STATS_BUTTON_LATENCY,
+}
+LINK_FIELDS = ["rx_frames", "rx_bad_frames", "rx_gaps", "rx_duplicates", "rx_window_stalls",
+               "acks_sent", "tx_dropped_high", "tx_dropped_bulk"]
+BUCKETS = 24  # LatencyHistogram::BUCKETS
+
+
+def frame(msg_type, payload=b""):
+    body = bytes([msg_type]) + payload
+    checksum = 0
+    for b in body:
+        checksum ^= b
+    return bytes([0xAA, len(body) >> 8, len(body) & 0xFF]) + body + bytes([checksum])
+
+
+class Link:
+    def __init__(self, port):
+        self.port = serial.Serial(port, 115200, timeout=0.05)
+        self.buf = bytearray()
+
+    def send(self, msg_type, payload=b""):
+        self.port.write(frame(msg_type, payload))
+
+    def frames(self):
+        """Complete v1 frames read so far, as (type, payload)."""
+        self.buf += self.port.read(4096)
+        while True:
+            start = self.buf.find(0xAA)
+            if start < 0:
+                self.buf.clear()
+                return
+            del self.buf[:start]
+            if len(self.buf) < 3:
+                return
+            body_len = self.buf[1] << 8 | self.buf[2]
+            if len(self.buf) < 4 + body_len:
+                return
+            body = bytes(self.buf[3:3 + body_len])
+            checksum = 0
+            for b in body:
+                checksum ^= b
+            if body_len == 0 or checksum != self.buf[3 + body_len]:
+                del self.buf[:1]
+                continue
+            del self.buf[:4 + body_len]
+            yield body[0], body[1:]
+
+    def stats(self, stats_id, timeout=1.0):
+        self.send(MSG_GET_STATS, bytes([stats_id]))
+        deadline = time.monotonic() + timeout
+        while time.monotonic() < deadline:
+            for msg_type, payload in self.frames():
+                if msg_type == MSG_STATS and payload[:1] == bytes([stats_id]):
+                    return payload[1:]
+        return None
+
+
+def read_histogram(link, stats_id):
+    data = link.stats(stats_id)
+    if data is None or len(data) < (5 + BUCKETS) * 4:
+        return None
+    values = struct.unpack_from("<%dI" % (5 + BUCKETS), data)
+    return {"count": values[0], "max": values[4], "buckets": list(values[5:])}
+
+
+def percentile(buckets, p):
+    """Upper edge of the bucket holding the p-th percentile, as the firmware reports it."""
+    total = sum(buckets)
+    if total == 0:
+        return 0
+    rank = (total * p + 99) // 100
+    seen = 0
+    for b, n in enumerate(buckets):
+        seen += n
+        if seen >= rank:
+            return 0 if b == 0 else (1 << b) - 1
+    return (1 << BUCKETS) - 1
+
+
+def summarize(before, after):
+    buckets = [a - b for a, b in zip(after["buckets"], before["buckets"])]
+    summary = {"count": sum(buckets)}
+    for p in (50, 90, 99):
+        summary["p%d_us" % p] = percentile(buckets, p)
+    summary["max_us_since_boot"] = after["max"]
+    summary["buckets"] = buckets
+    return summary
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("port")
+    parser.add_argument("--texts", type=int, default=100, help="notification texts to send")
+    parser.add_argument("--interval", type=float, default=100, help="ms between texts")
+    parser.add_argument("--length", type=int, default=300, help="bytes per text")
+    parser.add_argument("--json", help="also write the results to this file")
+    args = parser.parse_args()
+
+    link = Link(args.port)
+    before = {name: read_histogram(link, sid) for name, sid in HISTOGRAMS.items()}
+    if before["text_latency"] is None:
+        sys.exit("no MSG_STATS reply; is the bridge holding the port?")
+
+    filler = ("The quick brown fox jumps over the lazy dog. " * (args.length // 45 + 1))
+    for i in range(args.texts):
+        # A different first byte every time, so each is laid out and drawn in full
+        text = ("%d " % i + filler)[:args.length]
+        link.send(MSG_DISPLAY_TEXT, text.encode())
+        time.sleep(args.interval / 1000)
+        for _ in link.frames():
+            pass
+    time.sleep(0.5)
+
+    results = {"texts": args.texts, "interval_ms": args.interval, "length": args.length}
+    for name, sid in HISTOGRAMS.items():
+        after = read_histogram(link, sid)
+        if before[name] is None or after is None:
+            continue
+        results[name] = summarize(before[name], after)
+    link_stats = link.stats(STATS_LINK)
+    if link_stats and len(link_stats) >= 4 * len(LINK_FIELDS):
+        results["link"] = dict(zip(LINK_FIELDS, struct.unpack_from("<8I", link_stats)))
+
+    for name in HISTOGRAMS:
+        if name in results:
+            r = results[name]
+            print("%-15s %6d samples  p50 %7d us  p90 %7d us  p99 %7d us" %
+                  (name, r["count"], r["p50_us"], r["p90_us"], r["p99_us"]))
+    if "link" in results:
+        print("link           ", " ".join("%s=%d" % kv for kv in results["link"].items()))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()